@@ -0,0 +1,17 @@
+#ifndef BATCH_DISPLAY_H
+#define BATCH_DISPLAY_H
+
+#include <ostream>
+
+#include "refresh_scheduler.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+
+namespace BatchDisplay {
+void Display(SnapshotSource& source, RefreshScheduler& scheduler,
+             std::ostream& out, int n = 10);
+void DisplaySnapshot(Snapshot const& snapshot,
+                     RefreshScheduler const& scheduler, std::ostream& out);
+};  // namespace BatchDisplay
+
+#endif
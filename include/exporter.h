@@ -0,0 +1,60 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "snapshot.h"
+
+/*
+Serves the sampled metrics in the Prometheus text format
+The address is either "unix:/path/to/socket" for a Unix domain socket or
+"[host:]port" for HTTP, on the loopback interface unless another IPv4 address
+is given. The complete response is rendered once per tick, so a scrape only
+copies the latest buffer. Scrapers are served concurrently with non-blocking
+I/O, so a slow one does not hold up the others.
+*/
+class Exporter {
+ public:
+  // Constructor
+  explicit Exporter(std::string const& address);
+  ~Exporter();
+  Exporter(Exporter const&) = delete;
+  Exporter& operator=(Exporter const&) = delete;
+
+  bool Start();
+  void Publish(Snapshot const& snapshot);
+
+ private:
+  void Render(Snapshot const& snapshot, std::string& response) const;
+  // A scrape in progress, dropped if it doesn't complete by its deadline
+  struct Client {
+    int fd{-1};
+    std::string request{};
+    std::string response{};  // empty until the request header is read
+    std::size_t sent{0};
+    std::chrono::steady_clock::time_point deadline{};
+  };
+
+  void Serve();
+  bool Receive(Client& client);
+  bool Send(Client& client);
+
+  std::string address_;
+  int listen_fd_{-1};
+  std::thread thread_{};
+  std::atomic<bool> running_{false};
+  // The sampler renders into back_ and swaps it with front_ under the mutex
+  std::mutex mutex_{};
+  std::string front_{};
+  std::string back_{};
+  // Only used by the serving thread
+  std::vector<Client> clients_{};
+};
+
+#endif
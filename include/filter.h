@@ -0,0 +1,66 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+Predicate over process fields, compiled once from an expression such as
+  user==postgres && cpu>5 && cmd~"worker"
+Comparisons can be combined with &&, || and !, and grouped with parentheses.
+The fields are read in stages of increasing cost, and the predicate can be
+evaluated after every stage with the fields known so far, so a process is
+dropped before its more expensive files are read.
+*/
+class Filter {
+ public:
+  // Stages in the order their files are read
+  enum Stage { kStat = 0, kStatm, kStatus, kCmdline };
+  enum Result { kFalse = 0, kTrue, kUnknown };
+
+  // Field values of one process, valid up to the stage passed to Evaluate
+  struct Fields {
+    int pid{0};
+    float cpu{0.0};  // in percent
+    char state{'?'};
+    long uptime{0};  // in seconds
+    long ram{0};     // in MB
+    int uid{-1};
+    std::string_view user{};
+    std::string_view command{};
+  };
+
+  bool Compile(std::string const& expression, std::string& error);
+  bool Empty() const;
+  std::string const& Expression() const;
+  Result Evaluate(Fields const& fields, Stage stage) const;
+  bool Needs(Stage stage) const;
+
+ private:
+  enum Field { kPid, kCpu, kState, kUptime, kRam, kUid, kUser, kCommand };
+  enum Operator { kEqual, kNotEqual, kLess, kLessEqual, kGreater,
+                  kGreaterEqual, kContains, kNotContains };
+  struct Node {
+    enum Kind { kAnd, kOr, kNot, kCompare } kind;
+    int left{-1};
+    int right{-1};
+    Field field{kPid};
+    Operator op{kEqual};
+    double number{0.0};
+    std::string text{};
+  };
+
+  class Parser;
+
+  Result Evaluate(int node, Fields const& fields, Stage stage) const;
+  static Stage StageOf(Field field);
+
+  std::string expression_{};
+  std::vector<Node> nodes_{};
+  int root_{-1};
+  // One bit for every stage whose fields are compared
+  unsigned stages_{0};
+};
+
+#endif
@@ -1,10 +1,20 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "snapshot.h"
 
 namespace Format {
-std::string ElapsedTime(long times);  
+std::string ElapsedTime(long times);
+std::string Alert(AlertRecord const& alert);
+std::string Sparkline(std::vector<std::uint8_t> const& samples, int scale,
+                      std::size_t width);
+std::string List(std::vector<int> const& numbers);
+std::string Processor(ProcessRecord const& process);
 };                                    // namespace Format
 
 #endif
\ No newline at end of file
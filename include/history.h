@@ -0,0 +1,45 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Number of samples kept for the sparklines of a process and of the system
+constexpr std::size_t kProcessHistory{16};
+constexpr std::size_t kSystemHistory{32};
+
+/*
+The last N samples of a percentage, one byte each
+It never allocates, so a history per process keeps the memory bounded.
+*/
+template <std::size_t N>
+class History {
+ public:
+  static_assert(N > 0 && N < 256, "the counters are single bytes");
+
+  // Add a sample from 0.0 to 1.0, dropping the oldest once the window is full
+  void Push(float fraction) {
+    float const percent = fraction * 100 + 0.5f;
+    values_[next_] = percent <= 0 ? 0 : percent >= 100 ? 100 : percent;
+    next_ = (next_ + 1) % N;
+    count_ += count_ < N;
+  }
+
+  // Copy the samples in percent, oldest first
+  void CopyTo(std::vector<std::uint8_t>& samples) const {
+    samples.resize(count_);
+    std::size_t const first = (next_ + N - count_) % N;
+    for (std::size_t i = 0; i < count_; ++i) {
+      samples[i] = values_[(first + i) % N];
+    }
+  }
+
+ private:
+  std::array<std::uint8_t, N> values_{};
+  std::uint8_t next_{0};
+  std::uint8_t count_{0};
+};
+
+#endif
@@ -4,6 +4,10 @@
 #include <fstream>
 #include <regex>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "proc_fields.h"
 
 namespace LinuxParser {
 // Paths
@@ -12,16 +16,23 @@ const std::string kCmdlineFilename{"/cmdline"};
 const std::string kCpuinfoFilename{"/cpuinfo"};
 const std::string kStatusFilename{"/status"};
 const std::string kStatFilename{"/stat"};
+const std::string kStatmFilename{"/statm"};
+const std::string kSchedstatFilename{"/schedstat"};
 const std::string kUptimeFilename{"/uptime"};
 const std::string kMeminfoFilename{"/meminfo"};
 const std::string kVersionFilename{"/version"};
 const std::string kOSPath{"/etc/os-release"};
 const std::string kPasswordPath{"/etc/passwd"};
+const std::string kNodeDirectory{"/sys/devices/system/node/"};
+const std::string kOnlineFilename{"online"};
+const std::string kCpulistFilename{"/cpulist"};
+const std::string kNumaMapsFilename{"/numa_maps"};
 
 // System
 float MemoryUtilization();
 long UpTime();
-std::vector<int> Pids();
+bool Pids(std::vector<int>& pids,
+          std::string const& directory = kProcDirectory);
 int TotalProcesses();
 int RunningProcesses();
 std::string OperatingSystem();
@@ -45,13 +56,58 @@ long Jiffies();
 long ActiveJiffies();
 long ActiveJiffies(int pid);
 long IdleJiffies();
+// Jiffies of one CPU, from its line of /proc/stat
+struct CoreJiffies {
+  int cpu{0};
+  long active{0};
+  long total{0};
+};
+bool ReadCoreJiffies(std::vector<CoreJiffies>& cores);
+
+// NUMA
+// Memory of a node in KB, from its meminfo file
+struct NodeMemory {
+  long total{0};
+  long free{0};
+  long file_pages{0};
+  long reclaimable{0};  // slab
+};
+bool ParseList(std::string_view text, std::vector<int>& numbers);
+bool ListContains(std::string_view text, int number);
+bool Nodes(std::vector<int>& nodes);
+bool NodeCpus(int node, std::vector<int>& cpus);
+bool ReadNodeMemory(int node, NodeMemory& memory);
+bool NumaPages(int pid, std::vector<long>& kilobytes);
 
 // Processes
+bool ReadProcessFile(int pid, std::string const& filename,
+                     std::string_view& text);
+// Read the fields of a record from one process file with a single read
+template <typename Record>
+bool ReadFields(int pid, std::string const& filename, Record& record) {
+  std::string_view text;
+  return ReadProcessFile(pid, filename, text) && record.Parse(text);
+}
+// Fields of /proc/[pid]/status, which is read in one pass for all of them
+struct ProcessStatus {
+  int uid{-1};  // real UID
+  long vm_size{0};  // in KB
+  long voluntary_switches{0};
+  long involuntary_switches{0};
+  // CPUs the process may run on, e.g. "0-3,8", valid until the next read of
+  // a process file from the same thread
+  std::string_view cpus_allowed{};
+};
+bool ReadStatus(int pid, ProcessStatus& status);
 std::string Command(int pid);
 std::string Ram(int pid);
 std::string Uid(int pid);
 std::string User(int pid);
+std::string UserName(int uid);
 long int UpTime(int pid);
+long StartTime(int pid);
+char State(int pid);
+long Rss(int pid);
 };  // namespace LinuxParser
 
 #endif
\ No newline at end of file
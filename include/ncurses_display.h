@@ -2,14 +2,24 @@
 #define NCURSES_DISPLAY_H
 
 #include <curses.h>
+#include <string>
 
-#include "process.h"
-#include "system.h"
+#include "refresh_scheduler.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
 
 namespace NCursesDisplay {
-void Display(System& system, int n = 10);
-void DisplaySystem(System& system, WINDOW* window);
-void DisplayProcesses(std::vector<Process>& processes, WINDOW* window, int n);
+void Display(SnapshotSource& source, RefreshScheduler& scheduler, int n = 10);
+void DisplaySystem(SystemRecord const& system,
+                   RefreshScheduler const& scheduler, WINDOW* window);
+void DisplayHosts(std::vector<HostRecord> const& hosts, WINDOW* window);
+void DisplayNodes(std::vector<NodeRecord> const& nodes, WINDOW* window);
+void DisplayProcesses(std::vector<ProcessRecord> const& processes,
+                      std::string const& sort, int selected, WINDOW* window,
+                      int n);
+void DisplayStatus(std::string const& filter, std::string const& message,
+                   WINDOW* window);
+std::string PromptFilter(std::string const& current, WINDOW* window);
 std::string ProgressBar(float percent);
 };  // namespace NCursesDisplay
 
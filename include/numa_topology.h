@@ -0,0 +1,30 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <vector>
+
+#include "linux_parser.h"
+#include "snapshot.h"
+
+/*
+The NUMA nodes of the system with their memory and the load of their CPUs
+The nodes and their CPUs are listed once; every sample reads the memory of
+each node and the jiffies of each CPU, whose load is measured since the
+previous sample.
+*/
+class NumaTopology {
+ public:
+  bool Sample(std::vector<NodeRecord>& nodes);
+
+ private:
+  bool listed_{false};
+  std::vector<int> nodes_{};
+  std::vector<std::vector<int>> cpus_{};  // per node
+  // Jiffies of the previous sample, indexed by CPU ID
+  std::vector<LinuxParser::CoreJiffies> previous_{};
+  std::vector<LinuxParser::CoreJiffies> current_{};
+  // The lines of /proc/stat, kept to reuse their capacity
+  std::vector<LinuxParser::CoreJiffies> cores_{};
+};
+
+#endif
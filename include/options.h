@@ -0,0 +1,53 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+Command line options of the monitor
+*/
+// Largest --top accepted, every process record takes room in the segment
+const std::size_t kMaxTop{100000};
+
+struct Options {
+  // Bounds of the adaptive refresh interval in milliseconds
+  long min_interval_ms{100};
+  long max_interval_ms{5000};
+  // Maximum share of one CPU the monitor may use before it slows down
+  float cpu_cap{0.05};
+  // Number of top processes sampled for the exporter and the shared snapshot
+  std::size_t top{10};
+  // Serve metrics on this address instead of showing the display
+  std::string export_address{};
+  // Publish snapshots under this shared-memory name instead of showing them
+  std::string publish_name{};
+  // Show the snapshots published under this name instead of sampling /proc
+  std::string attach_name{};
+  // Show only the processes matching this expression
+  std::string filter{};
+  // Rank the processes by this column, one of kSortColumns
+  std::string sort{};
+  // Alert rules evaluated on every snapshot, see RuleEngine::AddRule
+  std::vector<std::string> rules{};
+  // Command run for every alert that fires or resolves
+  std::string alert_hook{};
+  // Stream the snapshots to the collector listening on this address
+  std::string send_address{};
+  // Name of this host in the streamed snapshots, the hostname by default
+  std::string host_name{};
+  // Merge the snapshots streamed to this address instead of sampling /proc
+  std::string collect_address{};
+  // Read the files of the processes in batches through io_uring
+  bool io_uring{false};
+  // Write the snapshots as plain text instead of using ncurses
+  bool batch{false};
+};
+
+namespace CommandLine {
+bool Parse(int argc, char* argv[], Options& options);
+std::string Usage(std::string const& program);
+};  // namespace CommandLine
+
+#endif
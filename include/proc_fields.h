@@ -0,0 +1,254 @@
+#ifndef PROC_FIELDS_H
+#define PROC_FIELDS_H
+
+#include <array>
+#include <cstddef>
+#include <iterator>  // For std::size
+#include <string_view>
+
+/*
+Compile-time schemas of the space separated /proc/[pid] files and a parser
+specialized for the fields a caller needs
+A Record names its fields as template arguments, e.g.
+  ProcFields::Record<ProcFields::StatSchema, Stat::kState, Stat::kStartTime>
+and extracts exactly those in one pass over the text, without copying tokens.
+*/
+namespace ProcFields {
+
+enum class Kind { kNumber, kChar, kText };
+
+struct Field {
+  int index;  // 1-based, as numbered in proc(5)
+  char const* name;
+  Kind kind;
+};
+
+// Fields of /proc/[pid]/stat
+namespace Stat {
+enum : int {
+  kPid = 1, kComm, kState, kPpid, kPgrp, kSession, kTtyNr, kTpgid, kFlags,
+  kMinflt, kCminflt, kMajflt, kCmajflt, kUtime, kStime, kCutime, kCstime,
+  kPriority, kNice, kNumThreads, kItrealvalue, kStartTime, kVsize, kRss,
+  kRsslim, kStartCode, kEndCode, kStartStack, kKstkesp, kKstkeip, kSignal,
+  kBlocked, kSigignore, kSigcatch, kWchan, kNswap, kCnswap, kExitSignal,
+  kProcessor, kRtPriority, kPolicy, kDelayacctBlkioTicks, kGuestTime,
+  kCguestTime, kStartData, kEndData, kStartBrk, kArgStart, kArgEnd,
+  kEnvStart, kEnvEnd, kExitCode
+};
+}  // namespace Stat
+
+// Fields of /proc/[pid]/statm, in pages
+namespace Statm {
+enum : int { kSize = 1, kResident, kShared, kText, kLib, kData, kDirty };
+}  // namespace Statm
+
+// Fields of /proc/[pid]/schedstat, times in nanoseconds
+namespace Schedstat {
+enum : int { kRunTime = 1, kWaitTime, kTimeslices };
+}  // namespace Schedstat
+
+struct StatSchema {
+  // comm is parenthesized and may itself contain spaces and parentheses
+  static constexpr int kParenthesized{Stat::kComm};
+  static constexpr Field kFields[] = {
+      {Stat::kPid, "pid", Kind::kNumber},
+      {Stat::kComm, "comm", Kind::kText},
+      {Stat::kState, "state", Kind::kChar},
+      {Stat::kPpid, "ppid", Kind::kNumber},
+      {Stat::kPgrp, "pgrp", Kind::kNumber},
+      {Stat::kSession, "session", Kind::kNumber},
+      {Stat::kTtyNr, "tty_nr", Kind::kNumber},
+      {Stat::kTpgid, "tpgid", Kind::kNumber},
+      {Stat::kFlags, "flags", Kind::kNumber},
+      {Stat::kMinflt, "minflt", Kind::kNumber},
+      {Stat::kCminflt, "cminflt", Kind::kNumber},
+      {Stat::kMajflt, "majflt", Kind::kNumber},
+      {Stat::kCmajflt, "cmajflt", Kind::kNumber},
+      {Stat::kUtime, "utime", Kind::kNumber},
+      {Stat::kStime, "stime", Kind::kNumber},
+      {Stat::kCutime, "cutime", Kind::kNumber},
+      {Stat::kCstime, "cstime", Kind::kNumber},
+      {Stat::kPriority, "priority", Kind::kNumber},
+      {Stat::kNice, "nice", Kind::kNumber},
+      {Stat::kNumThreads, "num_threads", Kind::kNumber},
+      {Stat::kItrealvalue, "itrealvalue", Kind::kNumber},
+      {Stat::kStartTime, "starttime", Kind::kNumber},
+      {Stat::kVsize, "vsize", Kind::kNumber},
+      {Stat::kRss, "rss", Kind::kNumber},
+      {Stat::kRsslim, "rsslim", Kind::kNumber},
+      {Stat::kStartCode, "startcode", Kind::kNumber},
+      {Stat::kEndCode, "endcode", Kind::kNumber},
+      {Stat::kStartStack, "startstack", Kind::kNumber},
+      {Stat::kKstkesp, "kstkesp", Kind::kNumber},
+      {Stat::kKstkeip, "kstkeip", Kind::kNumber},
+      {Stat::kSignal, "signal", Kind::kNumber},
+      {Stat::kBlocked, "blocked", Kind::kNumber},
+      {Stat::kSigignore, "sigignore", Kind::kNumber},
+      {Stat::kSigcatch, "sigcatch", Kind::kNumber},
+      {Stat::kWchan, "wchan", Kind::kNumber},
+      {Stat::kNswap, "nswap", Kind::kNumber},
+      {Stat::kCnswap, "cnswap", Kind::kNumber},
+      {Stat::kExitSignal, "exit_signal", Kind::kNumber},
+      {Stat::kProcessor, "processor", Kind::kNumber},
+      {Stat::kRtPriority, "rt_priority", Kind::kNumber},
+      {Stat::kPolicy, "policy", Kind::kNumber},
+      {Stat::kDelayacctBlkioTicks, "delayacct_blkio_ticks", Kind::kNumber},
+      {Stat::kGuestTime, "guest_time", Kind::kNumber},
+      {Stat::kCguestTime, "cguest_time", Kind::kNumber},
+      {Stat::kStartData, "start_data", Kind::kNumber},
+      {Stat::kEndData, "end_data", Kind::kNumber},
+      {Stat::kStartBrk, "start_brk", Kind::kNumber},
+      {Stat::kArgStart, "arg_start", Kind::kNumber},
+      {Stat::kArgEnd, "arg_end", Kind::kNumber},
+      {Stat::kEnvStart, "env_start", Kind::kNumber},
+      {Stat::kEnvEnd, "env_end", Kind::kNumber},
+      {Stat::kExitCode, "exit_code", Kind::kNumber},
+  };
+};
+
+struct StatmSchema {
+  static constexpr int kParenthesized{0};
+  static constexpr Field kFields[] = {
+      {Statm::kSize, "size", Kind::kNumber},
+      {Statm::kResident, "resident", Kind::kNumber},
+      {Statm::kShared, "shared", Kind::kNumber},
+      {Statm::kText, "text", Kind::kNumber},
+      {Statm::kLib, "lib", Kind::kNumber},
+      {Statm::kData, "data", Kind::kNumber},
+      {Statm::kDirty, "dt", Kind::kNumber},
+  };
+};
+
+struct SchedstatSchema {
+  static constexpr int kParenthesized{0};
+  static constexpr Field kFields[] = {
+      {Schedstat::kRunTime, "run_time", Kind::kNumber},
+      {Schedstat::kWaitTime, "wait_time", Kind::kNumber},
+      {Schedstat::kTimeslices, "timeslices", Kind::kNumber},
+  };
+};
+
+// Return true if every entry of a schema sits at the position of its index
+template <typename Schema>
+constexpr bool IsOrdered() {
+  int position{1};
+  for (Field const& field : Schema::kFields) {
+    if (field.index != position++) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+Values of the fields Indices... of one line of a file described by Schema
+Numbers are stored as they are, a char field as its character code.
+*/
+template <typename Schema, int... Indices>
+class Record {
+  static constexpr std::size_t kCount{sizeof...(Indices)};
+  static constexpr int kFieldCount = std::size(Schema::kFields);
+  static constexpr std::array<int, kCount> kIndices{Indices...};
+  static constexpr int kLast{kIndices[kCount - 1]};
+
+  // Position of each field index in values_, or -1 if it is not extracted
+  static constexpr std::array<int, kLast + 1> Slots() {
+    std::array<int, kLast + 1> slots{};
+    for (int& slot : slots) {
+      slot = -1;
+    }
+    for (std::size_t i = 0; i < kCount; ++i) {
+      slots[kIndices[i]] = i;
+    }
+    return slots;
+  }
+
+  static constexpr bool Valid() {
+    for (std::size_t i = 0; i < kCount; ++i) {
+      if (kIndices[i] < 1 || kIndices[i] > kFieldCount ||
+          (i > 0 && kIndices[i] <= kIndices[i - 1]) ||
+          Schema::kFields[kIndices[i] - 1].kind == Kind::kText) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static_assert(kCount > 0, "a record needs at least one field");
+  static_assert(IsOrdered<Schema>(),
+                "the schema must list every field in order");
+  static_assert(Valid(),
+                "fields must be ascending, in the schema and not text");
+
+  static constexpr std::array<int, kLast + 1> kSlots{Slots()};
+
+ public:
+  /**
+   * @brief Extracts the fields from one line in a single pass.
+   *
+   * Tokens are only scanned, never copied. A parenthesized field is skipped
+   * up to its last closing parenthesis, so spaces and parentheses inside it
+   * don't shift the following fields. Parsing stops after the last field.
+   *
+   * @param text std::string_view: The contents of the file.
+   * @return bool: True if all fields were found, false otherwise.
+   */
+  bool Parse(std::string_view text) {
+    std::size_t pos{0};
+    int field{1};
+    while (field <= kLast) {
+      if (field == Schema::kParenthesized) {
+        std::size_t close = text.rfind(')');
+        if (close == std::string_view::npos || close < pos) {
+          return false;
+        }
+        pos = close + 1;
+        ++field;
+        continue;
+      }
+      while (pos < text.size() && text[pos] == ' ') {
+        ++pos;
+      }
+      if (pos >= text.size() || text[pos] == '\n') {
+        return false;
+      }
+      int const slot = kSlots[field];
+      if (slot >= 0) {
+        values_[slot] = Schema::kFields[field - 1].kind == Kind::kChar
+                            ? text[pos]
+                            : Number(text, pos);
+      }
+      while (pos < text.size() && text[pos] != ' ' && text[pos] != '\n') {
+        ++pos;
+      }
+      ++field;
+    }
+    return true;
+  }
+
+  // Return the value of one of the extracted fields
+  template <int Index>
+  long Get() const {
+    static_assert(Index <= kLast && kSlots[Index] >= 0,
+                  "the field is not part of this record");
+    return values_[kSlots[Index]];
+  }
+
+ private:
+  // Parse a decimal number starting at pos, unsigned values wrap around
+  static long Number(std::string_view text, std::size_t pos) {
+    bool const negative = text[pos] == '-';
+    pos += negative;
+    unsigned long value{0};
+    for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos) {
+      value = value * 10 + (text[pos] - '0');
+    }
+    return negative ? -static_cast<long>(value) : static_cast<long>(value);
+  }
+
+  std::array<long, kCount> values_{};
+};
+
+}  // namespace ProcFields
+
+#endif
@@ -1,36 +1,40 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class ProcessTable;
+
 /*
-Basic class for Process representation
-It contains relevant attributes as shown below
+Lightweight view of one row of the process table
+It contains no data of its own and stays valid until the table is updated.
 */
 class Process {
  public:
   // Constructor
-  Process(int pid);  
-
-  int Pid();                               
-  std::string User();                      
-  std::string Command();                   
-  float CpuUtilization();                  
-  std::string Ram() const;                       
-  long int UpTime();                       
-  bool operator<(Process const& a) const;  
-  bool operator>(Process const& a) const; 
+  Process(ProcessTable const& table, std::size_t row);
 
+  int Pid() const;
+  std::string_view User() const;
+  std::string_view Command() const;
+  float CpuUtilization() const;
+  void CpuHistory(std::vector<std::uint8_t>& samples) const;
+  float Wait() const;
+  float VoluntarySwitches() const;
+  float InvoluntarySwitches() const;
+  int Processor() const;
+  long Migrations() const;
+  bool OutsideAffinity() const;
+  long Ram() const;
+  long int UpTime() const;
+  char State() const;
 
  private:
-    int pid_;
-    // Caching is appropriate because these values do not change during the runtime.
-    std::string user_;
-    std::string cmdline_;
-    // caching cpu utilization because it is used in the comparison function multiple times
-    // float cpu_utilization_;
-    // Store the previous values for active and total jiffies for calculating the difference
-    long prev_active_jiffies_{0};
-    long prev_total_jiffies_{0};
+  ProcessTable const* table_;
+  std::size_t row_;
 };
 
-#endif
\ No newline at end of file
+#endif
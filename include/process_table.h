@@ -0,0 +1,122 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "batch_reader.h"
+#include "filter.h"
+#include "history.h"
+#include "process.h"
+#include "string_pool.h"
+
+namespace LinuxParser {
+struct ProcessStatus;
+}
+
+/*
+Columnar table of all processes of the system
+Every metric is stored in its own contiguous array, indexed by row, so that
+ranking, thresholds and aggregations are tight loops over plain numbers.
+Rows persist across ticks as long as their process lives, which is what the
+CPU deltas are computed from. Command and user are indices into a string pool.
+Rows rejected by the filter are kept for their CPU deltas but are hidden.
+*/
+class ProcessTable {
+ public:
+  void Update(std::vector<int> const& pids);
+  bool UseBatchReads();
+  bool SetFilter(std::string const& expression, std::string& error);
+  std::string const& FilterExpression() const;
+  bool SetSort(std::string const& column, std::string& error);
+  std::string SortColumn() const;
+  std::size_t Size() const;
+  bool Contains(int pid) const;
+  Process operator[](std::size_t row) const;
+
+  void TopK(std::size_t k, std::vector<std::uint32_t>& rows) const;
+  long TotalRss() const;
+  void Occupancy(std::vector<std::uint8_t>& cpus) const;
+  StringPool::Usage StringUsage() const;
+
+ private:
+  friend class Process;
+
+  // Marks a command line or user that has not been read yet
+  static constexpr std::uint32_t kNoString{0xffffffff};
+  // Marks a start time that has not been read yet
+  static constexpr long kNoStartTime{-1};
+
+  // Files of a process read so far in the current update
+  enum : char { kStatRead = 1, kStatmRead = 2, kSchedstatRead = 4 };
+  // Columns the rows can be ranked by, in the order of kSortColumns
+  enum SortKey : int { kSortCpu, kSortWait, kSortVoluntary, kSortInvoluntary };
+  // Marks a counter that has not been read yet
+  static constexpr long kNotRead{0};
+
+  void ReadBatch(std::vector<int> const& pids);
+  std::size_t ApplyStat(std::size_t row, long starttime, long active_jiffies,
+                        char state, int processor);
+  void ApplyStatus(std::size_t row,
+                   LinuxParser::ProcessStatus const& status);
+  void ApplyWait(std::size_t row, long wait_time);
+  bool Admit(std::size_t row, float cpu, char read);
+  void ReadStage(std::size_t row, Filter::Stage stage, char read,
+                 Filter::Fields& fields);
+  void Release(std::uint32_t id);
+  std::size_t AddRow(int pid);
+  void RemoveRow(std::size_t row);
+
+  // One entry per row in each column
+  std::vector<int> pid_{};
+  std::vector<long> starttime_{};
+  std::vector<long> active_jiffies_{};
+  std::vector<int> cpu_delta_{};  // jiffies since the previous update
+  std::vector<float> cpu_{};
+  std::vector<History<kProcessHistory>> cpu_history_{};
+  // Scheduler counters, their rates since they were last read and when that
+  // was, in nanoseconds of the monotonic clock
+  std::vector<long> wait_time_{};  // in nanoseconds
+  std::vector<float> wait_{};
+  std::vector<long> wait_read_{};
+  std::vector<long> voluntary_switches_{};
+  std::vector<long> involuntary_switches_{};
+  std::vector<float> voluntary_rate_{};
+  std::vector<float> involuntary_rate_{};
+  std::vector<long> status_read_{};
+  // The CPU each process last ran on, how often that changed between two
+  // updates, and whether it lies outside the process's Cpus_allowed_list
+  std::vector<int> processor_{};
+  std::vector<long> migrations_{};
+  std::vector<char> outside_affinity_{};
+  std::vector<long> rss_{};  // in KB
+  std::vector<char> state_{};
+  std::vector<int> uid_{};
+  std::vector<std::uint32_t> command_{};
+  std::vector<std::uint32_t> user_{};
+  std::vector<char> visible_{};  // passed the filter during the last update
+
+  std::unordered_map<int, std::size_t> rows_{};
+  // Sorted IDs of the previous update and the changes since then
+  std::vector<int> pids_{};
+  std::vector<int> births_{};
+  std::vector<int> exits_{};
+  // Files read per process of the current update, in the order of the IDs
+  std::vector<char> read_{};
+  BatchReader reader_{};
+  StringPool strings_{};
+  Filter filter_{};
+  SortKey sort_{kSortCpu};
+  // Store the previous value of the total jiffies for calculating the
+  // difference
+  long prev_total_jiffies_{0};
+  long uptime_{0};
+  long now_{0};  // monotonic time of the current update in nanoseconds
+  // Scratch buffer of the ranking, kept to reuse its capacity
+  mutable std::vector<float> scratch_{};
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef REFRESH_SCHEDULER_H
+#define REFRESH_SCHEDULER_H
+
+#include <chrono>
+#include <vector>
+
+/*
+Adaptive refresh scheduler for the sampling loop
+The interval grows while the observed metrics are stable or the monitor's own
+CPU share exceeds the configured cap, and shrinks while the metrics change
+quickly. Deadlines are chained from the previous deadline so ticks don't drift.
+*/
+class RefreshScheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Milliseconds = std::chrono::milliseconds;
+
+  // Constructor
+  RefreshScheduler(Milliseconds min_interval = Milliseconds{100},
+                   Milliseconds max_interval = Milliseconds{5000},
+                   float cpu_cap = 0.05);
+
+  void BeginTick();
+  void Observe(float value);
+  Milliseconds EndTick();
+  Milliseconds Remaining() const;
+  void SleepUntilNextTick() const;
+
+  Milliseconds Interval() const;
+  float SelfCpuShare() const;
+
+ private:
+  double SelfCpuSeconds() const;
+
+  Milliseconds min_interval_;
+  Milliseconds max_interval_;
+  float cpu_cap_;
+  Milliseconds interval_;
+  Clock::time_point deadline_;
+  // Store the metrics of the previous tick for calculating the change rate
+  std::vector<float> prev_values_{};
+  std::vector<float> values_{};
+  // Store the previous values of wall time and own cpu time for the self cost
+  Clock::time_point prev_wall_{};
+  double prev_cpu_seconds_{0.0};
+  float self_cpu_share_{0.0};
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <array>
+#include <cstddef>
+
+/*
+Streaming statistics with constant cost and memory per sample
+*/
+
+// Exponentially weighted moving average over time
+class Ewma {
+ public:
+  explicit Ewma(double time_constant) : time_constant_{time_constant} {}
+
+  void Add(double value, double elapsed_seconds);
+  double Value() const { return value_; }
+
+ private:
+  double time_constant_;
+  double value_{0.0};
+  bool empty_{true};
+};
+
+// The last N samples, with the least-squares slope over them
+template <std::size_t N>
+class RingBuffer {
+ public:
+  static_assert(N >= 2, "a slope needs at least two samples");
+
+  // Add a sample, dropping the oldest one once the window is full
+  void Push(double value) {
+    if (count_ < N) {
+      weighted_ += count_ * value;
+      sum_ += value;
+      ++count_;
+    } else {
+      // Every sample moves one position down, the oldest one drops out
+      double const oldest = values_[next_];
+      weighted_ += (N - 1) * value - (sum_ - oldest);
+      sum_ += value - oldest;
+    }
+    values_[next_] = value;
+    next_ = (next_ + 1) % N;
+  }
+
+  bool Full() const { return count_ == N; }
+  std::size_t Count() const { return count_; }
+
+  // Return the change per sample of the best fitting line through the window
+  double Slope() const {
+    if (count_ < 2) {
+      return 0.0;
+    }
+    double const n = count_;
+    double const sum_x = n * (n - 1) / 2;
+    double const sum_xx = (n - 1) * n * (2 * n - 1) / 6;
+    return (n * weighted_ - sum_x * sum_) / (n * sum_xx - sum_x * sum_x);
+  }
+
+ private:
+  std::array<double, N> values_{};
+  std::size_t next_{0};
+  std::size_t count_{0};
+  double sum_{0.0};       // of the values
+  double weighted_{0.0};  // of each value times its position, oldest at 0
+};
+
+// Streaming estimate of one quantile with the P-square algorithm
+class P2Quantile {
+ public:
+  explicit P2Quantile(double quantile);
+
+  void Add(double value);
+  double Value() const;
+
+ private:
+  double Parabolic(int i, int direction) const;
+  double Linear(int i, int direction) const;
+
+  double quantile_;
+  std::size_t count_{0};
+  std::array<double, 5> heights_{};
+  std::array<double, 5> positions_{};
+  std::array<double, 5> desired_{};
+  std::array<double, 5> increments_{};
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <sys/types.h>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rolling_stats.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+
+/*
+Alert rules evaluated on every snapshot of another source, e.g.
+  process cpu > 90 for 30s
+  system memory rising for 5m
+Each rule keeps constant-size rolling statistics per subject (the system or
+one process, whether or not it ranks among the shown ones), so the cost per
+process and tick doesn't grow with history.
+An alert fires once its condition held for the rule's duration, and resolves
+once the value is back past the clear level for as long, so it doesn't flap.
+The alerts raised or resolved during a tick are added to its snapshot and,
+if a hook command is set, passed to it.
+*/
+class RuleEngine : public SnapshotSource {
+ public:
+  explicit RuleEngine(SnapshotSource& source, std::string hook = "");
+
+  bool AddRule(std::string const& text, std::string& error);
+  bool Sample(Snapshot& snapshot, std::size_t k) override;
+  bool SetFilter(std::string const& expression, std::string& error) override;
+  bool SetSort(std::string const& column, std::string& error) override;
+  bool NumaPages(int pid, std::vector<long>& kilobytes,
+                 std::string& error) override;
+  bool Running(int pid) const override;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Number of samples the slope of a rising or falling rule is fitted to
+  static constexpr std::size_t kWindow{16};
+  // Time constant of the averages in seconds
+  static constexpr double kAverageSeconds{30.0};
+  // Hook commands allowed to run at the same time
+  static constexpr std::size_t kMaxHooks{16};
+
+  struct Rule {
+    enum Metric { kCpu, kMemory, kRam } metric;
+    enum Statistic { kValue, kAverage, kQuantile } statistic{kValue};
+    enum Condition { kAbove, kBelow, kRising, kFalling } condition;
+    bool process{false};
+    double quantile{0.0};
+    double threshold{0.0};
+    double clear{0.0};
+    double seconds{0.0};
+    std::string text{};
+  };
+
+  // Rolling statistics and alert state of one rule for one subject
+  struct Track {
+    explicit Track(Rule const& rule);
+
+    Ewma average;
+    P2Quantile quantile;
+    RingBuffer<kWindow> window{};
+    bool firing{false};
+    bool pending{false};
+    Clock::time_point since{};
+    double value{0.0};
+  };
+
+  struct Subject {
+    long started{0};  // seconds after boot, tells a reused PID apart
+    bool seen{false};
+    std::vector<Track> tracks{};
+  };
+
+  void Evaluate(Rule const& rule, Track& track, double value,
+                std::string const& subject, Clock::time_point now,
+                double elapsed, std::vector<AlertRecord>& alerts);
+  void Resolve(Subject& subject, std::string const& name,
+               std::vector<AlertRecord>& alerts);
+  std::vector<Track> Tracks() const;
+  void RunHook(AlertRecord const& alert);
+  void ReapHooks();
+
+  SnapshotSource& source_;
+  std::string hook_;
+  std::vector<Rule> rules_{};
+  Subject system_{};
+  // Processes by host and PID, the host is empty for the local system
+  std::unordered_map<std::string, std::unordered_map<int, Subject>>
+      processes_{};
+  // Every visible process of the source, process rules are evaluated on all
+  Snapshot sample_{};
+  std::vector<pid_t> hooks_{};
+  Clock::time_point last_{};
+};
+
+#endif
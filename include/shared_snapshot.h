@@ -0,0 +1,115 @@
+#ifndef SHARED_SNAPSHOT_H
+#define SHARED_SNAPSHOT_H
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "history.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+
+/*
+Snapshots published in a POSIX shared-memory segment
+One writer publishes every tick, any number of readers map the segment
+read-only and never touch /proc. The segment is guarded by a seqlock: the
+sequence is odd while the writer is copying, and a reader retries whenever
+the sequence was odd or changed during its copy.
+*/
+namespace SharedLayout {
+// Bump the version whenever one of the structures below changes
+const std::uint32_t kMagic{0x4e4f4d53};  // "SMON"
+const std::uint32_t kVersion{7};
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t header_size;
+  std::uint32_t system_size;
+  std::uint32_t process_size;
+  std::uint32_t capacity;
+  std::atomic<std::uint64_t> sequence;
+};
+
+struct System {
+  float cpu;
+  float memory;
+  std::int64_t uptime;
+  std::int32_t total_processes;
+  std::int32_t running_processes;
+  std::uint32_t process_count;
+  std::int64_t process_ram;
+  std::int64_t string_memory;
+  std::int64_t string_referenced;
+  char operating_system[64];
+  char kernel[64];
+  char filter[128];
+  char sort[16];
+  std::uint8_t cpu_history_length;
+  std::uint8_t memory_history_length;
+  std::uint8_t cpu_history[kSystemHistory];
+  std::uint8_t memory_history[kSystemHistory];
+};
+
+struct Process {
+  std::int32_t pid;
+  float cpu;
+  float wait;
+  float voluntary_switches;
+  float involuntary_switches;
+  std::int32_t processor;
+  std::uint8_t outside_affinity;
+  std::int64_t migrations;
+  std::int64_t ram;
+  std::int64_t uptime;
+  char user[32];
+  char command[256];
+  std::uint8_t cpu_history_length;
+  std::uint8_t cpu_history[kProcessHistory];
+};
+
+std::size_t Size(std::uint32_t capacity);
+};  // namespace SharedLayout
+
+class SharedSnapshotWriter {
+ public:
+  ~SharedSnapshotWriter();
+
+  bool Open(std::string const& name, std::size_t capacity);
+  void Publish(Snapshot const& snapshot);
+
+ private:
+  std::string name_{};
+  void* memory_{nullptr};
+  std::size_t size_{0};
+  std::uint32_t capacity_{0};
+};
+
+class SharedSnapshotReader : public SnapshotSource {
+ public:
+  ~SharedSnapshotReader();
+
+  bool Attach(std::string const& name, std::string& error);
+  bool Sample(Snapshot& snapshot, std::size_t k) override;
+
+ private:
+  bool Current() const;
+  bool Replaced() const;
+
+  std::string name_{};
+  // Identify the mapped segment, a restarted writer may create a new one
+  dev_t device_{0};
+  ino_t inode_{0};
+  void const* memory_{nullptr};
+  std::size_t size_{0};
+  std::uint32_t capacity_{0};
+  std::uint64_t last_sequence_{0};
+  // Records are copied here first and only converted once the copy is valid
+  SharedLayout::System system_{};
+  std::vector<SharedLayout::Process> processes_{};
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Columns the processes can be ranked by, the first one by default
+constexpr char const* kSortColumns[] = {"cpu", "wait", "voluntary",
+                                        "involuntary"};
+
+/*
+Plain values sampled from the system during one tick
+Consumers of a snapshot never go back to /proc.
+*/
+struct SystemRecord {
+  std::string operating_system{};
+  std::string kernel{};
+  std::string filter{};  // the expression the processes were filtered with
+  std::string sort{};    // the column the processes were ranked by
+  float cpu{0.0};
+  float memory{0.0};
+  long uptime{0};
+  int total_processes{0};
+  int running_processes{0};
+  long process_ram{0};  // resident memory of all processes in MB
+  // Bytes used by the interned command lines and user names, and the bytes
+  // they would take if every process kept its own copies
+  long string_memory{0};
+  long string_referenced{0};
+  // Recent samples in percent, oldest first, at most kSystemHistory
+  std::vector<std::uint8_t> cpu_history{};
+  std::vector<std::uint8_t> memory_history{};
+};
+
+struct ProcessRecord {
+  int pid{0};
+  float cpu{0.0};
+  float wait{0.0};  // share of the time spent waiting for a CPU
+  // Context switches per second
+  float voluntary_switches{0.0};
+  float involuntary_switches{0.0};
+  int processor{-1};  // the CPU it last ran on, -1 if unknown
+  long migrations{0};  // moves to another CPU seen since it was first seen
+  bool outside_affinity{false};  // last ran outside its Cpus_allowed_list
+  long ram{0};  // in MB
+  long uptime{0};
+  std::string user{};
+  std::string command{};
+  std::string host{};  // the monitor the process was collected from, if any
+  // Recent CPU samples in percent, oldest first, at most kProcessHistory
+  std::vector<std::uint8_t> cpu_history{};
+};
+
+// Summary of one monitor feeding a collector, see SnapshotCollector
+struct HostRecord {
+  std::string name{};
+  float cpu{0.0};
+  float memory{0.0};
+  long uptime{0};
+  int running_processes{0};
+  long received{0};  // bytes since the monitor connected
+  long messages{0};  // snapshots since the monitor connected
+};
+
+// Memory and CPUs of one NUMA node, see NumaTopology
+struct NodeRecord {
+  int id{0};
+  float memory{0.0};  // share of the node's memory in use
+  long memory_total{0};  // in MB
+  long memory_used{0};
+  float cpu{0.0};  // average over the node's CPUs
+  std::vector<int> cpus{};
+  // Utilization of each CPU in percent, and the number of processes that
+  // were active on it, in the order of cpus
+  std::vector<std::uint8_t> cores{};
+  std::vector<std::uint8_t> occupancy{};
+};
+
+// An alert of a rule that fired or resolved, see RuleEngine
+struct AlertRecord {
+  bool firing{false};  // resolved if false
+  std::string rule{};
+  // "system" or the process, e.g. "pid 42 (nginx)", prefixed by its host
+  // when collected, e.g. "[web-1] pid 42 (nginx)"
+  std::string subject{};
+  double value{0.0};      // of the statistic the rule compares
+};
+
+struct Snapshot {
+  SystemRecord system{};
+  // The top processes in the order of the system's ranking
+  std::vector<ProcessRecord> processes{};
+  // The monitors a collector merged this snapshot from
+  std::vector<HostRecord> hosts{};
+  // The NUMA nodes of the local system, empty for other sources
+  std::vector<NodeRecord> nodes{};
+  // Alerts that fired or resolved with this snapshot
+  std::vector<AlertRecord> alerts{};
+};
+
+#endif
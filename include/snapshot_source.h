@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_SOURCE_H
+#define SNAPSHOT_SOURCE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "snapshot.h"
+
+/*
+Anything the displays can take a snapshot from
+This is either the local system or a snapshot published by another monitor.
+*/
+class SnapshotSource {
+ public:
+  virtual ~SnapshotSource() = default;
+  // Return false if no new snapshot is available, the old one is kept then
+  virtual bool Sample(Snapshot& snapshot, std::size_t k) = 0;
+  // Return false if the expression is invalid or the source cannot filter
+  virtual bool SetFilter(std::string const& expression, std::string& error) {
+    (void)expression;
+    error = "this monitor only shows the snapshots of another one";
+    return false;
+  }
+  // Return false if the column is unknown or the source cannot rank
+  virtual bool SetSort(std::string const& column, std::string& error) {
+    (void)column;
+    error = "this monitor only shows the snapshots of another one";
+    return false;
+  }
+  // Return false if the process is gone or the source cannot read its memory
+  virtual bool NumaPages(int pid, std::vector<long>& kilobytes,
+                         std::string& error) {
+    (void)pid;
+    (void)kilobytes;
+    error = "this monitor only shows the snapshots of another one";
+    return false;
+  }
+  // Return true if the process still runs, whether or not it was sampled
+  virtual bool Running(int pid) const {
+    (void)pid;
+    return false;
+  }
+};
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef SNAPSHOT_STREAM_H
+#define SNAPSHOT_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "history.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+
+/*
+Snapshots streamed from many monitors to one collector
+Every message is a frame of a 4-byte little-endian length and a payload
+starting with a type byte. A hello names the host, every following snapshot
+message only carries the fields that changed since the previous one: a
+varint bit mask per record selects the fields present, numbers are LEB128
+varints and strings a varint length followed by the bytes. Processes are
+identified by PID; one that was not part of the previous message is sent
+completely.
+*/
+namespace StreamProtocol {
+// Bump the version whenever the encoding below changes
+const std::uint32_t kVersion{3};
+enum Type : std::uint8_t { kHello = 1, kSnapshot = 2 };
+// Frames larger than this are rejected as corrupt
+const std::uint32_t kMaxFrame{1 << 20};
+
+// Bits of the system mask
+enum SystemField : std::uint32_t {
+  kCpu = 1 << 0,
+  kMemory = 1 << 1,
+  kUptime = 1 << 2,
+  kTotalProcesses = 1 << 3,
+  kRunningProcesses = 1 << 4,
+  kProcessRam = 1 << 5,
+  kOperatingSystem = 1 << 6,
+  kKernel = 1 << 7,
+};
+// Bits of a process mask
+enum ProcessField : std::uint32_t {
+  kProcessCpu = 1 << 0,
+  kRam = 1 << 1,
+  kStarted = 1 << 2,
+  kUser = 1 << 3,
+  kCommand = 1 << 4,
+  kWait = 1 << 5,
+  kVoluntarySwitches = 1 << 6,
+  kInvoluntarySwitches = 1 << 7,
+  kProcessor = 1 << 8,
+  kMigrations = 1 << 9,
+  kOutsideAffinity = 1 << 10,
+  kAllProcessFields = (1 << 11) - 1,
+};
+
+// The fields of a process as they were last sent
+struct ProcessState {
+  std::uint32_t cpu{0};  // in units of 0.01%
+  long ram{0};
+  long started{0};  // seconds after boot, unlike the uptime it is constant
+  std::string user{};
+  std::string command{};
+  std::uint32_t wait{0};  // in units of 0.01%
+  std::uint32_t voluntary_switches{0};  // per second
+  std::uint32_t involuntary_switches{0};
+  int processor{-1};
+  long migrations{0};
+  bool outside_affinity{false};
+};
+
+// The fields of a system as they were last sent
+struct SystemState {
+  std::uint32_t cpu{0};
+  std::uint32_t memory{0};
+  long uptime{0};
+  long total_processes{0};
+  long running_processes{0};
+  long process_ram{0};
+  std::string operating_system{};
+  std::string kernel{};
+};
+
+// Fields of one host, updated by every snapshot message it sends
+struct HostState {
+  std::string name{};
+  SystemState system{};
+  std::vector<int> pids{};  // in the order of the host's ranking
+  std::unordered_map<int, ProcessState> processes{};
+};
+
+void Hello(std::string const& host, std::string& frame);
+void Encode(Snapshot const& snapshot, HostState& previous, std::string& frame);
+bool Decode(std::string_view payload, HostState& host);
+};  // namespace StreamProtocol
+
+// Streams the top processes by CPU of this monitor to a collector
+class SnapshotSender {
+ public:
+  // Constructor
+  SnapshotSender(std::string const& address, std::string const& host,
+                 std::size_t k);
+  ~SnapshotSender();
+  SnapshotSender(SnapshotSender const&) = delete;
+  SnapshotSender& operator=(SnapshotSender const&) = delete;
+
+  void Publish(Snapshot const& snapshot);
+
+ private:
+  std::string address_;
+  std::string host_;
+  std::size_t k_;
+  int fd_{-1};
+  StreamProtocol::HostState sent_{};
+  std::string frame_{};
+  // The top k by CPU, picked when the snapshot is ranked by another column
+  Snapshot ranked_{};
+  std::vector<std::size_t> order_{};
+};
+
+/*
+Merges the snapshot streams of many monitors into one global ranking
+A thread accepts the monitors and applies their messages; Sample merges the
+hosts' rankings into the top processes overall.
+*/
+class SnapshotCollector : public SnapshotSource {
+ public:
+  // Constructor
+  explicit SnapshotCollector(std::string const& address);
+  ~SnapshotCollector();
+  SnapshotCollector(SnapshotCollector const&) = delete;
+  SnapshotCollector& operator=(SnapshotCollector const&) = delete;
+
+  bool Start();
+  bool Sample(Snapshot& snapshot, std::size_t k) override;
+
+ private:
+  struct Connection {
+    int fd{-1};
+    std::string buffer{};
+    bool greeted{false};
+    long received{0};
+    long messages{0};
+    StreamProtocol::HostState host{};
+    // The host's PIDs by CPU, whichever column the host ranked them by
+    std::vector<int> ranking{};
+    // Recent CPU samples of the processes, appended by every message
+    std::unordered_map<int, std::vector<std::uint8_t>> histories{};
+  };
+
+  void Serve();
+  bool Receive(Connection& connection);
+
+  std::string address_;
+  int listen_fd_{-1};
+  std::thread thread_{};
+  std::atomic<bool> running_{false};
+  // Guards the connections' hosts, which the serving thread updates
+  std::mutex mutex_{};
+  std::vector<Connection> connections_{};
+  bool updated_{false};
+  // Recent averages over the hosts, only used by Sample
+  History<kSystemHistory> cpu_history_{};
+  History<kSystemHistory> memory_history_{};
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SOCKET_ADDRESS_H
+#define SOCKET_ADDRESS_H
+
+#include <cstddef>
+#include <string>
+
+/*
+Stream sockets for the addresses accepted on the command line
+An address is either "unix:/path/to/socket" for a Unix domain socket or
+"[host:]port" for TCP, where the host is an IPv4 address and defaults to
+127.0.0.1, so a listener is only reachable from other machines if it is bound
+to another address explicitly. Ports range from 1 to 65535.
+*/
+namespace SocketAddress {
+bool Check(std::string const& address, std::string& error);
+int Listen(std::string const& address);
+int Connect(std::string const& address);
+void Remove(std::string const& address);
+bool SendAll(int fd, char const* data, std::size_t size);
+};  // namespace SocketAddress
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+Reference counted arena that stores every distinct string once
+Command lines and user names repeat across many processes, so each process
+only holds a compact ID. An entry is reclaimed, and its ID reused, as soon as
+the last process referencing it releases it.
+*/
+class StringPool {
+ public:
+  // Memory use of the pool, to compare with storing every string per process
+  struct Usage {
+    std::size_t strings{0};
+    std::size_t references{0};
+    std::size_t stored_bytes{0};
+    std::size_t referenced_bytes{0};
+    std::size_t memory_bytes{0};
+  };
+
+  std::uint32_t Intern(std::string_view value);
+  void Release(std::uint32_t id);
+  std::string_view Get(std::uint32_t id) const;
+  Usage MemoryUsage() const;
+
+ private:
+  struct Entry {
+    std::string value;
+    std::uint32_t references;
+  };
+
+  // A deque never moves its elements, so the views used as keys stay valid
+  std::deque<Entry> entries_{};
+  std::vector<std::uint32_t> free_{};
+  std::unordered_map<std::string_view, std::uint32_t> ids_{};
+  std::size_t references_{0};
+  std::size_t stored_bytes_{0};
+  std::size_t referenced_bytes_{0};
+};
+
+#endif
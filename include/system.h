@@ -1,26 +1,47 @@
 #ifndef SYSTEM_H
 #define SYSTEM_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
-#include "process.h"
+#include "history.h"
+#include "numa_topology.h"
+#include "process_table.h"
 #include "processor.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
 
-class System {
+class System : public SnapshotSource {
  public:
   Processor& Cpu();                   
-  std::vector<Process>& Processes();  
+  ProcessTable& Processes();          
   float MemoryUtilization();          
   long UpTime();                     
   int TotalProcesses();               
   int RunningProcesses();             
   std::string Kernel();               
   std::string OperatingSystem();      
+  bool Sample(Snapshot& snapshot, std::size_t k) override;
+  bool SetFilter(std::string const& expression, std::string& error) override;
+  bool SetSort(std::string const& column, std::string& error) override;
+  bool NumaPages(int pid, std::vector<long>& kilobytes,
+                 std::string& error) override;
+  bool Running(int pid) const override;
+  bool UseBatchReads();
 
  private:
   Processor cpu_{};
-  std::vector<Process> processes_{};
+  NumaTopology numa_{};
+  ProcessTable processes_{};
+  // Sorted IDs of the current processes, kept to reuse their capacity
+  std::vector<int> pids_{};
+  // Row indices of the ranked processes, kept to reuse their capacity
+  std::vector<std::uint32_t> ranking_{};
+  // Active processes per CPU, kept to reuse its capacity
+  std::vector<std::uint8_t> occupancy_{};
+  History<kSystemHistory> cpu_history_{};
+  History<kSystemHistory> memory_history_{};
 
   // Caching is appropriate because these values do not change during the runtime.
   std::string kernel_{};
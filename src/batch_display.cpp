@@ -0,0 +1,104 @@
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+#include "batch_display.h"
+#include "format.h"
+
+/**
+ * @brief Writes one snapshot as plain text.
+ *
+ * The first line summarizes the system and the refresh interval with the
+ * monitor's own CPU share, followed by one line per host of a
+ * collected snapshot, one line per NUMA node of the local system, a header
+ * and one line per process in the order of the snapshot, and one line per
+ * alert that fired or resolved with it.
+ *
+ * @param snapshot Snapshot const&: The snapshot to write.
+ * @param scheduler RefreshScheduler const&: The scheduler driving the ticks.
+ * @param out std::ostream&: The stream receiving the text.
+ */
+void BatchDisplay::DisplaySnapshot(Snapshot const& snapshot,
+                                   RefreshScheduler const& scheduler,
+                                   std::ostream& out) {
+  SystemRecord const& system = snapshot.system;
+  out << std::fixed << std::setprecision(1) << "up "
+      << Format::ElapsedTime(system.uptime) << "  cpu " << system.cpu * 100
+      << "%  memory " << system.memory * 100 << "%  running "
+      << system.running_processes << "  total " << system.total_processes
+      << "  strings " << system.string_memory / 1024 << "K for "
+      << system.string_referenced / 1024 << "K  refresh "
+      << scheduler.Interval().count() << "ms  self "
+      << scheduler.SelfCpuShare() * 100 << "%\n";
+  for (HostRecord const& host : snapshot.hosts) {
+    out << "host " << host.name << "  cpu " << host.cpu * 100 << "%  memory "
+        << host.memory * 100 << "%  running " << host.running_processes
+        << "  up " << Format::ElapsedTime(host.uptime) << "  received "
+        << host.received / 1024 << "K in " << host.messages << " snapshots\n";
+  }
+  for (NodeRecord const& node : snapshot.nodes) {
+    int active{0};
+    for (std::uint8_t const processes : node.occupancy) {
+      active += processes;
+    }
+    out << "node " << node.id << "  memory " << node.memory * 100 << "% of "
+        << node.memory_total << "M  cpu " << node.cpu * 100 << "% on "
+        << (node.cpus.empty() ? "none" : Format::List(node.cpus))
+        << "  active " << active << "\n";
+  }
+  if (!system.filter.empty()) {
+    out << "filter " << system.filter << "\n";
+  }
+  if (!system.sort.empty() && system.sort != kSortColumns[0]) {
+    out << "sort " << system.sort << "\n";
+  }
+  out << std::setw(7) << "PID" << " " << std::left << std::setw(10) << "USER"
+      << std::right << std::setw(7) << "CPU[%]" << std::setw(8) << "WAIT[%]"
+      << std::setw(9) << "RAM[MB]" << std::setw(7) << "VOL/s" << std::setw(7)
+      << "INV/s" << std::setw(6) << "LAST" << std::setw(6) << "MIG"
+      << std::setw(10) << "TIME+" << "  COMMAND\n";
+  for (ProcessRecord const& process : snapshot.processes) {
+    out << std::setw(7) << process.pid << " " << std::left << std::setw(10)
+        << process.user.substr(0, 9) << std::right << std::setw(7)
+        << process.cpu * 100 << std::setw(8) << process.wait * 100
+        << std::setw(9) << process.ram << std::setprecision(0) << std::setw(7)
+        << process.voluntary_switches << std::setw(7)
+        << process.involuntary_switches << std::setprecision(1)
+        << std::setw(6) << Format::Processor(process) << std::setw(6)
+        << process.migrations << std::setw(10)
+        << Format::ElapsedTime(process.uptime) << "  "
+        << (process.host.empty() ? "" : "[" + process.host + "] ")
+        << process.command << "\n";
+  }
+  for (AlertRecord const& alert : snapshot.alerts) {
+    out << Format::Alert(alert) << "\n";
+  }
+  out << std::endl;
+}
+
+/**
+ * @brief Writes every new snapshot of the source until the program ends.
+ *
+ * Ticks without a new snapshot, e.g. when the publishing monitor has not
+ * published since, write nothing.
+ *
+ * @param source SnapshotSource&: The source to take the snapshots from.
+ * @param scheduler RefreshScheduler&: The scheduler driving the ticks.
+ * @param out std::ostream&: The stream receiving the text.
+ * @param n int: The number of processes to write per snapshot.
+ */
+void BatchDisplay::Display(SnapshotSource& source, RefreshScheduler& scheduler,
+                           std::ostream& out, int n) {
+  Snapshot snapshot;
+  while (1) {
+    scheduler.BeginTick();
+    bool const updated = source.Sample(snapshot, n);
+    scheduler.Observe(snapshot.system.cpu);
+    scheduler.Observe(snapshot.system.memory);
+    if (updated) {
+      DisplaySnapshot(snapshot, scheduler, out);
+    }
+    scheduler.EndTick();
+    scheduler.SleepUntilNextTick();
+  }
+}
@@ -0,0 +1,297 @@
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "batch_reader.h"
+
+// Room for "/proc/" followed by a PID and a file name
+static constexpr std::size_t kPathSize{64};
+
+// The requests of a chain, stored in the user data with the slot and file
+enum Operation : std::uint64_t { kOpen = 0, kRead = 1, kClose = 2 };
+
+static std::uint64_t UserData(std::size_t slot, std::size_t file,
+                              Operation operation) {
+  return (std::uint64_t{slot} << 16) | (std::uint64_t{file} << 2) | operation;
+}
+
+// Close the ring when the reader is destroyed
+BatchReader::~BatchReader() { Close(); }
+
+/**
+ * @brief Sets up the ring, its file slots and its buffers.
+ *
+ * The ring is tried out on the files of this process, so a kernel without
+ * io_uring, or without opening into file slots (before 5.15), leaves the
+ * reader closed and the caller on its synchronous path. Files the kernel
+ * doesn't provide, e.g. schedstat without CONFIG_SCHED_INFO, are just never
+ * returned.
+ *
+ * @param filenames std::vector<std::string>: The files read per process, e.g.
+ *        LinuxParser::kStatFilename, in the order they are read.
+ * @return bool: True if the ring works, false otherwise.
+ */
+bool BatchReader::Open(std::vector<std::string> const& filenames) {
+  Close();
+  filenames_ = filenames;
+  std::size_t const files = filenames_.size();
+  if (files == 0) {
+    return false;
+  }
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, kSlots * 3 * files, &params);
+  if (ring_fd_ < 0) {
+    ring_fd_ = -1;
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool const single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    Close();
+    return false;
+  }
+  char* sq = static_cast<char*>(sq_ring_);
+  char* cq = static_cast<char*>(cq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  // One empty file slot per process in flight, one buffer per file
+  std::vector<int> slots(kSlots, -1);
+  slot_index_.assign(kSlots, 0);
+  paths_.assign(kSlots * files * kPathSize, '\0');
+  buffers_.assign(kSlots * files * kFileSize, '\0');
+  iovec buffers{buffers_.data(), buffers_.size()};
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES,
+              slots.data(), kSlots) != 0 ||
+      syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS,
+              &buffers, 1) != 0) {
+    Close();
+    return false;
+  }
+
+  std::vector<int> const self{getpid()};
+  std::size_t read{0};
+  Completion completion;
+  if (Start(self)) {
+    while (Next(completion)) {
+      ++read;
+    }
+  }
+  if (read == 0) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+// Return whether the ring is set up
+bool BatchReader::IsOpen() const { return ring_fd_ >= 0; }
+
+/**
+ * @brief Starts reading the files of the given processes.
+ *
+ * The first processes are queued right away, the rest as the first ones
+ * complete; Next submits them and returns the files as they are read.
+ *
+ * @param pids std::vector<int>: The processes to read, which must outlive the
+ *        batch.
+ * @return bool: True if the batch was started, false if the ring is closed.
+ */
+bool BatchReader::Start(std::vector<int> const& pids) {
+  if (!IsOpen()) {
+    return false;
+  }
+  pids_ = &pids;
+  next_ = 0;
+  in_flight_ = 0;
+  failed_ = false;
+  while (in_flight_ < kSlots && next_ < pids.size()) {
+    Queue(in_flight_++);
+  }
+  return true;
+}
+
+/**
+ * @brief Returns the next file of the batch that was read.
+ *
+ * Completions are taken from the ring as they arrive, and the slot of a
+ * process whose chain completed is refilled with the next process. Files that
+ * cannot be read, e.g. because the process exited, are skipped, as are files
+ * filling the whole buffer, which may be cut off. If the ring fails the
+ * reader closes and the remaining files are not read.
+ *
+ * @param completion Completion&: Receives the file that was read.
+ * @return bool: True if a file was returned, false once the batch is done.
+ */
+bool BatchReader::Next(Completion& completion) {
+  std::size_t const files = filenames_.size();
+  while (!failed_) {
+    unsigned const head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      if (in_flight_ == 0) {
+        return false;
+      }
+      if (!Submit(std::min<std::size_t>(outstanding_, kWait))) {
+        failed_ = true;
+        Close();
+      }
+      continue;
+    }
+    io_uring_cqe const& cqe =
+        static_cast<io_uring_cqe*>(cqes_)[head & cq_mask_];
+    std::uint64_t const data = cqe.user_data;
+    int const result = cqe.res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    --outstanding_;
+
+    std::size_t const slot = data >> 16;
+    std::size_t const file = (data >> 2) & 0x3fff;
+    Operation const operation = static_cast<Operation>(data & 3);
+    if (operation == kRead && result > 0 &&
+        static_cast<std::size_t>(result) < kFileSize) {
+      completion.index = slot_index_[slot];
+      completion.file = file;
+      completion.text = std::string_view(
+          buffers_.data() + (slot * files + file) * kFileSize, result);
+      return true;
+    }
+    if (operation == kClose && file + 1 == files) {
+      // The chain of the slot is done, it takes the next process
+      --in_flight_;
+      if (next_ < pids_->size()) {
+        Queue(slot);
+        ++in_flight_;
+      }
+    }
+  }
+  return false;
+}
+
+// Return whether the last batch was cut short by a failure of the ring
+bool BatchReader::Failed() const { return failed_; }
+
+// Unmap the rings and close the ring, which releases its slots and buffers
+void BatchReader::Close() {
+  if (sqes_ != nullptr && sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr && sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  sqes_ = cq_ring_ = sq_ring_ = nullptr;
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+  pending_ = 0;
+  outstanding_ = 0;
+  in_flight_ = 0;
+}
+
+/**
+ * @brief Queues the chain reading the files of the next process.
+ *
+ * For every file the chain opens it into the slot's file slot, reads it into
+ * the slot's buffer and closes it. The links are hard, so a failed open or
+ * read still closes the slot and the chain always completes with its last
+ * close.
+ *
+ * @param slot std::size_t: The free slot taking the process.
+ */
+void BatchReader::Queue(std::size_t slot) {
+  std::size_t const files = filenames_.size();
+  int const pid = (*pids_)[next_];
+  slot_index_[slot] = next_++;
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(sqes_);
+  auto push = [&](std::size_t file, Operation operation) {
+    unsigned const index = (*sq_tail_ + pending_++) & sq_mask_;
+    ++outstanding_;
+    io_uring_sqe& sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.user_data = UserData(slot, file, operation);
+    bool const last = file + 1 == files && operation == kClose;
+    sqe.flags = last ? 0 : IOSQE_IO_HARDLINK;
+    sq_array_[index] = index;
+    return &sqe;
+  };
+  for (std::size_t file = 0; file < files; ++file) {
+    char* path = paths_.data() + (slot * files + file) * kPathSize;
+    std::snprintf(path, kPathSize, "/proc/%d%s", pid,
+                  filenames_[file].c_str());
+    io_uring_sqe* open = push(file, kOpen);
+    open->opcode = IORING_OP_OPENAT;
+    open->fd = AT_FDCWD;
+    open->addr = reinterpret_cast<std::uint64_t>(path);
+    open->open_flags = O_RDONLY;
+    open->file_index = slot + 1;  // zero would allocate a regular descriptor
+
+    io_uring_sqe* read = push(file, kRead);
+    read->opcode = IORING_OP_READ_FIXED;
+    read->flags |= IOSQE_FIXED_FILE;
+    read->fd = slot;
+    read->addr = reinterpret_cast<std::uint64_t>(
+        buffers_.data() + (slot * files + file) * kFileSize);
+    read->len = kFileSize;
+    read->buf_index = 0;
+
+    io_uring_sqe* close = push(file, kClose);
+    close->opcode = IORING_OP_CLOSE;
+    close->file_index = slot + 1;
+  }
+}
+
+/**
+ * @brief Submits the queued requests and waits for completions.
+ *
+ * @param wait unsigned: The number of completions to wait for.
+ * @return bool: True on success, false if the ring failed.
+ */
+bool BatchReader::Submit(unsigned wait) {
+  unsigned const tail = *sq_tail_ + pending_;
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+  pending_ = 0;
+  while (1) {
+    // Requests the kernel did not take last time are submitted again
+    unsigned const queued = tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (syscall(__NR_io_uring_enter, ring_fd_, queued, wait,
+                wait > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0) >= 0) {
+      return true;
+    }
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+}
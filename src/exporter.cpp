@@ -0,0 +1,312 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+
+#include "exporter.h"
+#include "socket_address.h"
+
+// Long command lines are cut to keep the scrape size bounded
+const std::size_t kMaxLabelLength{128};
+
+// Escape a Prometheus label value (backslash, double quote and newline)
+static void AppendLabel(std::string& out, std::string const& value) {
+  std::size_t length = std::min(value.size(), kMaxLabelLength);
+  for (std::size_t i = 0; i < length; ++i) {
+    char c = value[i];
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+}
+
+// Append a metric family header
+static void AppendHeader(std::string& out, char const* name, char const* help,
+                         char const* type) {
+  out += "# HELP ";
+  out += name;
+  out += ' ';
+  out += help;
+  out += "\n# TYPE ";
+  out += name;
+  out += ' ';
+  out += type;
+  out += '\n';
+}
+
+// Append a sample without labels
+static void AppendSample(std::string& out, char const* name, double value) {
+  char number[32];
+  std::snprintf(number, sizeof(number), " %.6g\n", value);
+  out += name;
+  out += number;
+}
+
+// Append a sample labelled with the identity of a process
+static void AppendSample(std::string& out, char const* name,
+                         ProcessRecord const& process, double value) {
+  char number[32];
+  out += name;
+  out += "{pid=\"";
+  out += std::to_string(process.pid);
+  out += "\",user=\"";
+  AppendLabel(out, process.user);
+  out += "\",command=\"";
+  AppendLabel(out, process.command);
+  std::snprintf(number, sizeof(number), "\"} %.6g\n", value);
+  out += number;
+}
+
+/**
+ * @brief Constructs an exporter for the given address.
+ *
+ * The socket is not opened until Start is called.
+ *
+ * @param address std::string: "unix:/path" or "[host:]port", the host being
+ *        127.0.0.1 unless given.
+ */
+Exporter::Exporter(std::string const& address) : address_{address} {}
+
+// Stop serving and release the socket
+Exporter::~Exporter() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
+  SocketAddress::Remove(address_);
+}
+
+/**
+ * @brief Opens the listening socket and starts serving scrapes.
+ *
+ * @return bool: True if the socket is listening, false otherwise.
+ */
+bool Exporter::Start() {
+  listen_fd_ = SocketAddress::Listen(address_);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  // Scrapes arriving before the first tick are told to retry
+  front_ = "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+  running_ = true;
+  thread_ = std::thread(&Exporter::Serve, this);
+  return true;
+}
+
+/**
+ * @brief Renders a snapshot and makes it the response of the next scrapes.
+ *
+ * The response is rendered into the back buffer without holding the lock and
+ * then swapped with the front buffer, so both buffers keep their capacity.
+ *
+ * @param snapshot Snapshot const&: The snapshot of the current tick.
+ */
+void Exporter::Publish(Snapshot const& snapshot) {
+  Render(snapshot, back_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  front_.swap(back_);
+}
+
+/**
+ * @brief Renders the complete HTTP response for a snapshot.
+ *
+ * The body is written first, the header with its content length is then
+ * inserted in front of it. The buffer is cleared but keeps its capacity.
+ *
+ * @param snapshot Snapshot const&: The snapshot to render.
+ * @param response std::string&: The buffer receiving the response.
+ */
+void Exporter::Render(Snapshot const& snapshot, std::string& response) const {
+  response.clear();
+  AppendHeader(response, "monitor_cpu_utilization",
+               "Fraction of time the CPUs were busy.", "gauge");
+  AppendSample(response, "monitor_cpu_utilization", snapshot.system.cpu);
+  AppendHeader(response, "monitor_memory_utilization",
+               "Fraction of memory in use.", "gauge");
+  AppendSample(response, "monitor_memory_utilization", snapshot.system.memory);
+  AppendHeader(response, "monitor_uptime_seconds",
+               "Seconds since the system started.", "counter");
+  AppendSample(response, "monitor_uptime_seconds", snapshot.system.uptime);
+  AppendHeader(response, "monitor_forks_total",
+               "Processes created since the system started.", "counter");
+  AppendSample(response, "monitor_forks_total",
+               snapshot.system.total_processes);
+  AppendHeader(response, "monitor_processes_running",
+               "Processes currently running.", "gauge");
+  AppendSample(response, "monitor_processes_running",
+               snapshot.system.running_processes);
+
+  AppendHeader(response, "monitor_processes_resident_megabytes",
+               "Resident memory of all processes in MB.", "gauge");
+  AppendSample(response, "monitor_processes_resident_megabytes",
+               snapshot.system.process_ram);
+
+  AppendHeader(response, "monitor_string_pool_bytes",
+               "Memory used by the interned command lines and user names.",
+               "gauge");
+  AppendSample(response, "monitor_string_pool_bytes",
+               snapshot.system.string_memory);
+  AppendHeader(response, "monitor_string_pool_referenced_bytes",
+               "Bytes the interned strings would take without interning.",
+               "gauge");
+  AppendSample(response, "monitor_string_pool_referenced_bytes",
+               snapshot.system.string_referenced);
+
+  AppendHeader(response, "monitor_process_cpu_utilization",
+               "Fraction of CPU time used by a top process.", "gauge");
+  for (ProcessRecord const& process : snapshot.processes) {
+    AppendSample(response, "monitor_process_cpu_utilization", process,
+                 process.cpu);
+  }
+  AppendHeader(response, "monitor_process_memory_megabytes",
+               "Resident memory of a top process in MB.", "gauge");
+  for (ProcessRecord const& process : snapshot.processes) {
+    AppendSample(response, "monitor_process_memory_megabytes", process,
+                 process.ram);
+  }
+  AppendHeader(response, "monitor_process_uptime_seconds",
+               "Seconds since a top process started.", "gauge");
+  for (ProcessRecord const& process : snapshot.processes) {
+    AppendSample(response, "monitor_process_uptime_seconds", process,
+                 process.uptime);
+  }
+
+  response.insert(0,
+                  "HTTP/1.0 200 OK\r\n"
+                  "Content-Type: text/plain; version=0.0.4\r\n"
+                  "Content-Length: " +
+                      std::to_string(response.size()) + "\r\n\r\n");
+}
+
+// Scrapers served at the same time, further connections wait in the backlog
+const std::size_t kMaxClients{64};
+// Time a scraper has to send its request and receive the response
+const std::chrono::seconds kClientTimeout{1};
+// Longest request header read from a scraper
+const std::size_t kMaxRequest{8192};
+
+/**
+ * @brief Accepts and answers scrapes until the exporter is destroyed.
+ *
+ * All sockets are non-blocking and polled together, so every scraper only
+ * waits for its own reads and writes. A scraper that has not received its
+ * complete response by its deadline is disconnected.
+ */
+void Exporter::Serve() {
+  std::vector<pollfd> fds;
+  while (running_) {
+    fds.clear();
+    fds.push_back({clients_.size() < kMaxClients ? listen_fd_ : -1, POLLIN, 0});
+    for (Client const& client : clients_) {
+      fds.push_back({client.fd,
+                     static_cast<short>(client.response.empty() ? POLLIN
+                                                                : POLLOUT),
+                     0});
+    }
+    if (poll(fds.data(), fds.size(), 200) < 0) {
+      continue;
+    }
+    auto const now = std::chrono::steady_clock::now();
+    // Serve the clients polled above before accepting new ones
+    std::size_t kept{0};
+    for (std::size_t i = 0; i < clients_.size(); ++i) {
+      Client& client = clients_[i];
+      short const events = fds[i + 1].revents;
+      bool open = now < client.deadline;
+      if (open && (events & (POLLERR | POLLNVAL))) {
+        open = false;
+      } else if (open && (events & (POLLIN | POLLHUP)) &&
+                 client.response.empty()) {
+        open = Receive(client);
+      }
+      if (open && !client.response.empty()) {
+        open = Send(client);
+      }
+      if (open) {
+        clients_[kept++] = std::move(client);
+      } else {
+        close(client.fd);
+      }
+    }
+    clients_.resize(kept);
+    if (fds[0].revents & POLLIN) {
+      int fd = accept4(listen_fd_, nullptr, nullptr,
+                       SOCK_CLOEXEC | SOCK_NONBLOCK);
+      if (fd >= 0) {
+        Client client;
+        client.fd = fd;
+        client.deadline = now + kClientTimeout;
+        clients_.push_back(std::move(client));
+      }
+    }
+  }
+  for (Client const& client : clients_) {
+    close(client.fd);
+  }
+  clients_.clear();
+}
+
+/**
+ * @brief Reads what a scraper sent so far.
+ *
+ * The request itself is discarded, every path returns the metrics. Once its
+ * header is complete, or the scraper stopped sending, the latest response
+ * is copied for it. No more than kMaxRequest bytes are buffered; a scraper
+ * whose header doesn't end by then is dropped.
+ *
+ * @param client Client&: The scraper whose socket is readable.
+ * @return bool: True if the connection stays open, false otherwise.
+ */
+bool Exporter::Receive(Client& client) {
+  char buffer[1024];
+  ssize_t count{0};
+  bool complete{false};
+  while (!complete && client.request.size() < kMaxRequest &&
+         (count = read(client.fd, buffer,
+                       std::min(sizeof(buffer),
+                                kMaxRequest - client.request.size()))) > 0) {
+    client.request.append(buffer, count);
+    complete = client.request.find("\r\n\r\n") != std::string::npos;
+  }
+  if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    return false;
+  }
+  if (!complete && count != 0 && client.request.size() >= kMaxRequest) {
+    return false;
+  }
+  if (complete || count == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    client.response.assign(front_);
+  }
+  return true;
+}
+
+/**
+ * @brief Sends as much of the response as the socket takes.
+ *
+ * @param client Client&: The scraper with a response.
+ * @return bool: True if the connection stays open for the rest, false once
+ *         the response is sent or the scraper is gone.
+ */
+bool Exporter::Send(Client& client) {
+  while (client.sent < client.response.size()) {
+    ssize_t count = send(client.fd, client.response.data() + client.sent,
+                         client.response.size() - client.sent, MSG_NOSIGNAL);
+    if (count < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    client.sent += count;
+  }
+  return false;
+}
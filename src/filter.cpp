@@ -0,0 +1,369 @@
+#include <cctype>
+#include <cstdlib>
+#include <string>
+
+#include "filter.h"
+
+// Nesting of '!' and '(' allowed, so parsing cannot exhaust the stack
+const int kMaxDepth{64};
+
+// Recursive descent parser turning an expression into the nodes of a filter
+class Filter::Parser {
+ public:
+  Parser(std::string const& text, std::vector<Node>& nodes)
+      : text_{text}, nodes_{nodes} {}
+
+  /**
+   * @brief Parses the whole expression.
+   *
+   * @param error std::string&: Receives the reason if the expression is
+   * invalid.
+   * @return int: The index of the root node, or -1 if the expression is
+   * invalid.
+   */
+  int Parse(std::string& error) {
+    int root = Or();
+    SkipSpace();
+    if (root >= 0 && pos_ < text_.size()) {
+      Fail("unexpected '" + text_.substr(pos_, 1) + "'");
+      root = -1;
+    }
+    error = error_;
+    return root;
+  }
+
+ private:
+  // or := and ('||' and)*
+  int Or() {
+    int left = And();
+    while (left >= 0 && Consume("||")) {
+      left = Join(Node::kOr, left, And());
+    }
+    return left;
+  }
+
+  // and := unary ('&&' unary)*
+  int And() {
+    int left = Unary();
+    while (left >= 0 && Consume("&&")) {
+      left = Join(Node::kAnd, left, Unary());
+    }
+    return left;
+  }
+
+  // unary := '!' unary | '(' or ')' | comparison
+  int Unary() {
+    SkipSpace();
+    if (Consume("!")) {
+      if (!Enter()) {
+        return -1;
+      }
+      int inner = Join(Node::kNot, Unary(), -1);
+      --depth_;
+      return inner;
+    }
+    if (Consume("(")) {
+      if (!Enter()) {
+        return -1;
+      }
+      int inner = Or();
+      --depth_;
+      if (inner >= 0 && !Consume(")")) {
+        return Fail("missing ')'");
+      }
+      return inner;
+    }
+    return Comparison();
+  }
+
+  // Count one more level of '!' or '(', refusing to nest deeper than kMaxDepth
+  bool Enter() {
+    if (++depth_ > kMaxDepth) {
+      Fail("nested deeper than " + std::to_string(kMaxDepth) + " levels");
+      return false;
+    }
+    return true;
+  }
+
+  // comparison := field operator value
+  int Comparison() {
+    SkipSpace();
+    std::size_t start = pos_;
+    while (pos_ < text_.size() &&
+           std::isalpha(static_cast<unsigned char>(text_[pos_]))) {
+      ++pos_;
+    }
+    std::string name = text_.substr(start, pos_ - start);
+    Node node{Node::kCompare};
+    if (name == "pid") {
+      node.field = kPid;
+    } else if (name == "cpu") {
+      node.field = kCpu;
+    } else if (name == "state") {
+      node.field = kState;
+    } else if (name == "time") {
+      node.field = kUptime;
+    } else if (name == "ram") {
+      node.field = kRam;
+    } else if (name == "uid") {
+      node.field = kUid;
+    } else if (name == "user") {
+      node.field = kUser;
+    } else if (name == "cmd") {
+      node.field = kCommand;
+    } else {
+      return Fail(name.empty() ? "expected a field"
+                               : "unknown field '" + name + "'");
+    }
+
+    SkipSpace();
+    if (Consume("==")) {
+      node.op = kEqual;
+    } else if (Consume("!=")) {
+      node.op = kNotEqual;
+    } else if (Consume("<=")) {
+      node.op = kLessEqual;
+    } else if (Consume(">=")) {
+      node.op = kGreaterEqual;
+    } else if (Consume("<")) {
+      node.op = kLess;
+    } else if (Consume(">")) {
+      node.op = kGreater;
+    } else if (Consume("!~")) {
+      node.op = kNotContains;
+    } else if (Consume("~")) {
+      node.op = kContains;
+    } else {
+      return Fail("expected an operator after '" + name + "'");
+    }
+
+    if (!Value(node.text)) {
+      return -1;
+    }
+    bool const textual =
+        node.field == kState || node.field == kUser || node.field == kCommand;
+    bool const ordered = node.op != kEqual && node.op != kNotEqual &&
+                         node.op != kContains && node.op != kNotContains;
+    if (textual && ordered) {
+      return Fail("'" + name + "' can only be compared with ==, !=, ~ or !~");
+    }
+    if (!textual) {
+      if (node.op == kContains || node.op == kNotContains) {
+        return Fail("'" + name + "' is a number and cannot use ~");
+      }
+      char* end;
+      node.number = std::strtod(node.text.c_str(), &end);
+      if (node.text.empty() || *end != '\0') {
+        return Fail("'" + node.text + "' is not a number");
+      }
+    }
+    nodes_.push_back(node);
+    return nodes_.size() - 1;
+  }
+
+  // value := '"' characters '"' | characters up to a space, ')', '&' or '|'
+  bool Value(std::string& value) {
+    SkipSpace();
+    if (Consume("\"")) {
+      while (pos_ < text_.size() && text_[pos_] != '"') {
+        if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) {
+          ++pos_;
+        }
+        value += text_[pos_++];
+      }
+      if (!Consume("\"")) {
+        Fail("missing '\"'");
+        return false;
+      }
+      return true;
+    }
+    while (pos_ < text_.size() &&
+           !std::isspace(static_cast<unsigned char>(text_[pos_])) &&
+           text_[pos_] != ')' && text_[pos_] != '&' && text_[pos_] != '|') {
+      value += text_[pos_++];
+    }
+    if (value.empty()) {
+      Fail("expected a value");
+      return false;
+    }
+    return true;
+  }
+
+  int Join(Node::Kind kind, int left, int right) {
+    if (left < 0 || (kind != Node::kNot && right < 0)) {
+      return -1;
+    }
+    Node node{kind};
+    node.left = left;
+    node.right = right;
+    nodes_.push_back(node);
+    return nodes_.size() - 1;
+  }
+
+  bool Consume(std::string const& token) {
+    SkipSpace();
+    if (text_.compare(pos_, token.size(), token) == 0) {
+      pos_ += token.size();
+      return true;
+    }
+    return false;
+  }
+
+  void SkipSpace() {
+    while (pos_ < text_.size() &&
+           std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+      ++pos_;
+    }
+  }
+
+  int Fail(std::string const& message) {
+    if (error_.empty()) {
+      error_ = message + " at position " + std::to_string(pos_ + 1);
+    }
+    return -1;
+  }
+
+  std::string const& text_;
+  std::vector<Node>& nodes_;
+  std::size_t pos_{0};
+  int depth_{0};
+  std::string error_{};
+};
+
+/**
+ * @brief Compiles an expression into the predicate tree of this filter.
+ *
+ * An empty expression (or one of only spaces) compiles into a filter that
+ * matches every process. If the expression is invalid the filter is left
+ * unchanged.
+ *
+ * @param expression std::string: The expression to compile.
+ * @param error std::string&: Receives the reason if the expression is invalid.
+ * @return bool: True if the expression was compiled, false otherwise.
+ */
+bool Filter::Compile(std::string const& expression, std::string& error) {
+  std::vector<Node> nodes;
+  int root{-1};
+  if (expression.find_first_not_of(" \t") != std::string::npos) {
+    root = Parser(expression, nodes).Parse(error);
+    if (root < 0) {
+      return false;
+    }
+  }
+  expression_ = root < 0 ? "" : expression;
+  nodes_.swap(nodes);
+  root_ = root;
+  stages_ = 0;
+  for (Node const& node : nodes_) {
+    if (node.kind == Node::kCompare) {
+      stages_ |= 1u << StageOf(node.field);
+    }
+  }
+  return true;
+}
+
+// Return true if the filter matches every process
+bool Filter::Empty() const { return root_ < 0; }
+
+// Return true if the filter compares a field that is read in the stage
+bool Filter::Needs(Stage stage) const { return stages_ & (1u << stage); }
+
+// Return the expression the filter was compiled from
+std::string const& Filter::Expression() const { return expression_; }
+
+/**
+ * @brief Evaluates the filter with the fields read so far.
+ *
+ * Comparisons of fields from a later stage are unknown. An unknown operand
+ * only decides an && or || if the other operand doesn't, so kFalse after an
+ * early stage means the process can be dropped without reading the rest.
+ *
+ * @param fields Fields const&: The fields of the process.
+ * @param stage Stage: The last stage whose fields are valid.
+ * @return Result: kTrue or kFalse if decided, kUnknown otherwise.
+ */
+Filter::Result Filter::Evaluate(Fields const& fields, Stage stage) const {
+  if (root_ < 0) {
+    return kTrue;
+  }
+  return Evaluate(root_, fields, stage);
+}
+
+// Evaluate one node of the predicate tree in three-valued logic
+Filter::Result Filter::Evaluate(int index, Fields const& fields,
+                                Stage stage) const {
+  Node const& node = nodes_[index];
+  switch (node.kind) {
+    case Node::kAnd: {
+      Result left = Evaluate(node.left, fields, stage);
+      if (left == kFalse) {
+        return kFalse;
+      }
+      Result right = Evaluate(node.right, fields, stage);
+      return right == kFalse ? kFalse : (left == kTrue ? right : kUnknown);
+    }
+    case Node::kOr: {
+      Result left = Evaluate(node.left, fields, stage);
+      if (left == kTrue) {
+        return kTrue;
+      }
+      Result right = Evaluate(node.right, fields, stage);
+      return right == kTrue ? kTrue : (left == kFalse ? right : kUnknown);
+    }
+    case Node::kNot: {
+      Result inner = Evaluate(node.left, fields, stage);
+      return inner == kUnknown ? kUnknown : (inner == kTrue ? kFalse : kTrue);
+    }
+    case Node::kCompare:
+      break;
+  }
+  if (StageOf(node.field) > stage) {
+    return kUnknown;
+  }
+
+  std::string_view text;
+  double number{0.0};
+  switch (node.field) {
+    case kPid: number = fields.pid; break;
+    case kCpu: number = fields.cpu; break;
+    case kUptime: number = fields.uptime; break;
+    case kRam: number = fields.ram; break;
+    case kUid: number = fields.uid; break;
+    case kState: text = std::string_view(&fields.state, 1); break;
+    case kUser: text = fields.user; break;
+    case kCommand: text = fields.command; break;
+  }
+  bool const textual =
+      node.field == kState || node.field == kUser || node.field == kCommand;
+  bool match{false};
+  switch (node.op) {
+    case kEqual:
+      match = textual ? text == node.text : number == node.number;
+      break;
+    case kNotEqual:
+      match = textual ? text != node.text : number != node.number;
+      break;
+    case kLess: match = number < node.number; break;
+    case kLessEqual: match = number <= node.number; break;
+    case kGreater: match = number > node.number; break;
+    case kGreaterEqual: match = number >= node.number; break;
+    case kContains:
+      match = text.find(node.text) != std::string_view::npos;
+      break;
+    case kNotContains:
+      match = text.find(node.text) == std::string_view::npos;
+      break;
+  }
+  return match ? kTrue : kFalse;
+}
+
+// Return the stage after which a field is known
+Filter::Stage Filter::StageOf(Field field) {
+  switch (field) {
+    case kRam: return kStatm;
+    case kUid:
+    case kUser: return kStatus;
+    case kCommand: return kCmdline;
+    default: return kStat;
+  }
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 #include <iomanip>
 #include <sstream>
@@ -26,4 +27,75 @@ string Format::ElapsedTime(long seconds) {
            << std::setw(2) << std::setfill('0') << minutes << ":"
            << std::setw(2) << std::setfill('0') << seconds;
     return stream.str();
-}
\ No newline at end of file
+}
+
+// Return a one-line description of an alert, e.g. for the batch output
+string Format::Alert(AlertRecord const& alert) {
+    std::ostringstream stream;
+    stream << "alert " << (alert.firing ? "firing" : "resolved") << ": "
+           << alert.rule << ": " << alert.subject << " at " << std::fixed
+           << std::setprecision(1) << alert.value;
+    return stream.str();
+}
+
+/**
+ * @brief Draws recent samples as a line of Unicode block characters.
+ *
+ * Each sample becomes one of the eight blocks from U+2581 to U+2588 by its
+ * share of the scale, a sample of zero a space. Only the newest samples that
+ * fit into the width are drawn.
+ *
+ * @param samples std::vector<std::uint8_t>: The samples, oldest first.
+ * @param scale int: The value drawn as a full block.
+ * @param width std::size_t: The maximum number of characters.
+ * @return std::string: The sparkline, encoded in UTF-8.
+ */
+string Format::Sparkline(std::vector<std::uint8_t> const& samples, int scale,
+                         std::size_t width) {
+    string line;
+    std::size_t const first =
+        samples.size() > width ? samples.size() - width : 0;
+    for (std::size_t i = first; i < samples.size(); ++i) {
+        int const level = samples[i] == 0 || scale <= 0
+                              ? 0
+                              : std::min(8, 1 + samples[i] * 7 / scale);
+        if (level == 0) {
+            line += ' ';
+        } else {
+            line += "\xe2\x96";
+            line += static_cast<char>(0x80 + level);
+        }
+    }
+    return line;
+}
+
+// Return ascending numbers as a list of ranges like sysfs does, e.g. "0-3,8"
+string Format::List(std::vector<int> const& numbers) {
+    string list;
+    for (std::size_t i = 0; i < numbers.size();) {
+        std::size_t last = i;
+        while (last + 1 < numbers.size() &&
+               numbers[last + 1] == numbers[last] + 1) {
+            ++last;
+        }
+        if (!list.empty()) {
+            list += ',';
+        }
+        list += std::to_string(numbers[i]);
+        if (last > i) {
+            list += '-' + std::to_string(numbers[last]);
+        }
+        i = last + 1;
+    }
+    return list;
+}
+
+// Return the CPU a process last ran on, marked with '!' if it is outside the
+// CPUs the process is allowed on, or "-" if unknown
+string Format::Processor(ProcessRecord const& process) {
+    if (process.processor < 0) {
+        return "-";
+    }
+    return std::to_string(process.processor) +
+           (process.outside_affinity ? "!" : "");
+}
@@ -1,6 +1,16 @@
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
@@ -68,37 +78,64 @@ std::string LinuxParser::Kernel() {
   return "";
 }
 
-// BONUS: Update this to use std::filesystem
 /**
- * @brief Retrieves a list of process IDs (PIDs) from the /proc directory.
+ * @brief Retrieves the sorted IDs of all processes from the /proc directory.
  *
- * This function opens the /proc directory and iterates through its entries.
- * It checks each entry to determine if it is a directory and if the directory
- * name consists entirely of digits. If both conditions are met, the directory
- * name is converted to an integer and added to the list of PIDs.
+ * This function reads the directory entries with getdents64 into a large
+ * buffer, so a few system calls cover thousands of processes, and parses
+ * the digits of each name in place instead of building a string per entry.
+ * Entries that are not directories or whose name is not a number are
+ * skipped. /proc already lists the processes in ascending order, so the
+ * final sort only has work to do for other directories.
  *
- * @return A vector of integers representing the process IDs.
+ * @param pids std::vector<int>&: Receives the IDs, its capacity is reused.
+ * @param directory std::string: The directory to list, /proc by default.
+ * @return bool: True if the directory could be read, false otherwise.
  */
-vector<int> LinuxParser::Pids() {
-  vector<int> pids;
-  DIR* directory = opendir(kProcDirectory.c_str());
-  struct dirent* file;
-  while ((file = readdir(directory)) != nullptr) {
-    // Is this a directory?
-    if (file->d_type == DT_DIR) {
-      // Is every character of the name a digit?
-      std::string filename(file->d_name);
-      if (std::all_of(filename.begin(), filename.end(), isdigit)) {
-        int pid = stoi(filename);
+bool LinuxParser::Pids(vector<int>& pids, std::string const& directory) {
+  pids.clear();
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  // Layout of the entries written by getdents64, see getdents(2)
+  struct Entry {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+  };
+  thread_local std::vector<char> buffer(1 << 18);
+  long bytes;
+  while ((bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size())) >
+         0) {
+    for (long offset = 0; offset < bytes;) {
+      auto const* entry = reinterpret_cast<Entry const*>(&buffer[offset]);
+      offset += entry->d_reclen;
+      if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
+        continue;
+      }
+      // At most 9 digits, larger numbers are no PIDs and would overflow
+      int pid{0};
+      int digits{0};
+      char const* name = entry->d_name;
+      for (; *name >= '0' && *name <= '9' && digits < 9; ++name, ++digits) {
+        pid = pid * 10 + (*name - '0');
+      }
+      // A longer name still points at a digit here
+      if (*name == '\0' && digits > 0) {
         pids.push_back(pid);
       }
     }
   }
-  closedir(directory);
-  return pids;
+  close(fd);
+  if (!std::is_sorted(pids.begin(), pids.end())) {
+    std::sort(pids.begin(), pids.end());
+  }
+  return bytes == 0;
 }
 
-
 /**
  * @brief Calculate the memory utilization of the system.
  * 
@@ -185,6 +222,39 @@ long LinuxParser::Jiffies() {
 }
 
 
+/**
+ * @brief Reads a small file of a process with a single read.
+ *
+ * The path is formatted into a stack buffer and the contents are read into a
+ * per-thread buffer, so no memory is allocated. The stat, statm, schedstat
+ * and status files are shorter than the buffer.
+ *
+ * @param pid int: The process ID whose file is read.
+ * @param filename std::string: The name of the file, e.g. kStatFilename.
+ * @param text std::string_view&: Receives the contents, valid until the next
+ *        call from the same thread.
+ * @return bool: True if the file could be read, false otherwise.
+ */
+bool LinuxParser::ReadProcessFile(int pid, std::string const& filename,
+                                  std::string_view& text) {
+  char path[64];
+  std::snprintf(path, sizeof(path), "%s%d%s", kProcDirectory.c_str(), pid,
+                filename.c_str());
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  thread_local char buffer[4096];
+  ssize_t bytes = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (bytes <= 0) {
+    return false;
+  }
+  text = std::string_view(buffer, bytes);
+  return true;
+}
+
+
 /**
  * @brief Calculates the active jiffies for a given process.
  *
@@ -195,24 +265,15 @@ long LinuxParser::Jiffies() {
  * @param pid int: The process ID for which to calculate active jiffies.
  * @return long: The total active jiffies for the process, or 0 if the file cannot be read.
  */
-long LinuxParser::ActiveJiffies(int pid) { 
-  std::ifstream file_stream(kProcDirectory + std::to_string(pid) + kStatFilename);
-  if(file_stream){
-    std::string line;
-    std::getline(file_stream, line);
-    std::istringstream linestream(line);
-    std::string value;
-    long utime{0}, stime{0}, cutime{0}, cstime{0};
-    for (int i = 1; i <= 22; i++){
-      linestream >> value;
-      if (i == 14) utime = std::stol(value);
-      if (i == 15) stime = std::stol(value);
-      if (i == 16) cutime = std::stol(value);
-      if (i == 17) cstime = std::stol(value);
-    }
-    return utime + stime + cutime + cstime;
+long LinuxParser::ActiveJiffies(int pid) {
+  using namespace ProcFields;
+  Record<StatSchema, Stat::kUtime, Stat::kStime, Stat::kCutime, Stat::kCstime>
+      stat;
+  if (!ReadFields(pid, kStatFilename, stat)) {
+    return 0;
   }
-  return 0; 
+  return stat.Get<Stat::kUtime>() + stat.Get<Stat::kStime>() +
+         stat.Get<Stat::kCutime>() + stat.Get<Stat::kCstime>();
 }
 
 
@@ -337,6 +398,61 @@ int LinuxParser::RunningProcesses() {
 }
 
 
+/**
+ * @brief Reads the fields of a process's status file in a single pass.
+ *
+ * The file is read with one read, see ReadProcessFile, and every line is
+ * matched against the few keys of interest, so the UID, the memory, the
+ * context switches and the allowed CPUs all come from the same read.
+ *
+ * @param pid int: The process ID whose status file is read.
+ * @param status ProcessStatus&: Receives the fields found in the file.
+ * @return bool: True if the file could be read, false otherwise.
+ */
+bool LinuxParser::ReadStatus(int pid, ProcessStatus& status) {
+  std::string_view text;
+  if (!ReadProcessFile(pid, kStatusFilename, text)) {
+    return false;
+  }
+  status = ProcessStatus{};
+  // Return the first number after a key if the line starts with it
+  auto value = [](std::string_view line, std::string_view key, long& number) {
+    if (line.substr(0, key.size()) != key) {
+      return false;
+    }
+    std::size_t pos = line.find_first_of("0123456789", key.size());
+    number = 0;
+    for (; pos < line.size() && line[pos] >= '0' && line[pos] <= '9'; ++pos) {
+      number = number * 10 + (line[pos] - '0');
+    }
+    return true;
+  };
+  // Return the text after a key, without the leading blanks, likewise
+  auto list = [](std::string_view line, std::string_view key,
+                 std::string_view& text) {
+    if (line.substr(0, key.size()) != key) {
+      return false;
+    }
+    line.remove_prefix(key.size());
+    text = line.substr(std::min(line.find_first_not_of(" \t"), line.size()));
+    return true;
+  };
+  long uid{-1};
+  while (!text.empty()) {
+    std::size_t const end = std::min(text.find('\n'), text.size());
+    std::string_view const line = text.substr(0, end);
+    text.remove_prefix(std::min(end + 1, text.size()));
+    value(line, "Uid:", uid) || value(line, "VmSize:", status.vm_size) ||
+        value(line, "voluntary_ctxt_switches:", status.voluntary_switches) ||
+        value(line, "nonvoluntary_ctxt_switches:",
+              status.involuntary_switches) ||
+        list(line, "Cpus_allowed_list:", status.cpus_allowed);
+  }
+  status.uid = uid;
+  return true;
+}
+
+
 /**
  * @brief Retrieves the command that was used to start a process.
  *
@@ -351,12 +467,13 @@ int LinuxParser::RunningProcesses() {
 std::string LinuxParser::Command(int pid) {
   std::ifstream file_stream(kProcDirectory + std::to_string(pid) + kCmdlineFilename);
   if (file_stream) {
-    std::string line;
-    std::getline(file_stream, line, '\0');  // Read until the first null character
-    std::string command = line;
-    while (std::getline(file_stream, line, '\0')) {
-      command += " " + line; // replace the null character with a space
+    // Read the whole file at once, the arguments are separated by null characters
+    std::string command{std::istreambuf_iterator<char>(file_stream),
+                        std::istreambuf_iterator<char>()};
+    while (!command.empty() && command.back() == '\0') {
+      command.pop_back();
     }
+    std::replace(command.begin(), command.end(), '\0', ' ');
     // Replace newline characters with spaces
     std::replace(command.begin(), command.end(), '\n', ' ');
     return command;
@@ -364,52 +481,39 @@ std::string LinuxParser::Command(int pid) {
   return ""; 
 }
 
-// TODO: Read and return the memory used by a process
-// REMOVE: [[maybe_unused]] once you define the function
+/**
+ * @brief Retrieves the virtual memory size of a process.
+ *
+ * This function reads the /proc/[pid]/status file, see ReadStatus, and returns
+ * the value of its "VmSize:" line converted from KB to MB.
+ *
+ * @param pid int: The process ID for which the memory is to be retrieved.
+ * @return std::string: The memory in MB as a string, or "0" if the file cannot be read.
+ */
 std::string LinuxParser::Ram(int pid) {
-  std::ifstream file_stream(kProcDirectory + std::to_string(pid) + kStatusFilename);
-  if(file_stream){
-    std::string line;
-    std::string key;
-    long value;
-    while(std::getline(file_stream, line)){
-      std::istringstream linestream(line);
-      linestream >> key >> value;
-      if (key == "VmSize:"){
-        long ram = value / 1024; // convert from KB to MB
-        return std::to_string(ram);
-      }
-    }
+  ProcessStatus status;
+  if (!ReadStatus(pid, status)) {
+    return "0";
   }
-   return "0"; 
+  return std::to_string(status.vm_size / 1024);  // convert from KB to MB
 }
 
 
 /**
  * @brief Retrieves the UID of a process given its PID.
  *
- * This function reads the /proc/[pid]/status file to find the UID of the process.
- * It opens the file, reads it line by line, and searches for the line that starts
- * with "Uid:". Once found, it extracts and returns the UID value (the first integer).
+ * This function reads the /proc/[pid]/status file, see ReadStatus, and returns
+ * the first value of its "Uid:" line, the real UID.
  *
  * @param pid int: The process ID for which the UID is to be retrieved.
  * @return std::string: The UID of the process as a string. If the UID cannot be found, an empty string is returned.
  */
-std::string LinuxParser::Uid(int pid) { 
-  std::ifstream file_stream(kProcDirectory +std::to_string(pid) + kStatusFilename);
-  if(file_stream){
-    std::string line;
-    while(std::getline(file_stream, line)){
-      std::istringstream linestream(line);
-      std::string key;
-      std::string value;
-      linestream >> key >> value;
-      if(key == "Uid:"){
-        return value;
-      }
-    }
+std::string LinuxParser::Uid(int pid) {
+  ProcessStatus status;
+  if (!ReadStatus(pid, status) || status.uid < 0) {
+    return "";
   }
-  return ""; 
+  return std::to_string(status.uid);
 }
 
 
@@ -417,37 +521,60 @@ std::string LinuxParser::Uid(int pid) {
  * @brief Retrieves the username associated with a given process ID (PID).
  *
  * This function reads the UID of the process from the /proc filesystem and then
- * looks up the corresponding username from the /etc/passwd file.
+ * looks it up with UserName.
  *
  * @param pid int: The process ID for which to retrieve the username.
  * @return std::string: The username associated with the given PID, or an empty string if the
  *         username could not be found.
  */
-std::string LinuxParser::User(int pid) { 
-  std::string uid = LinuxParser::Uid(pid);
-  std::ifstream file_stream(kPasswordPath);
-  if(file_stream){
+std::string LinuxParser::User(int pid) {
+  ProcessStatus status;
+  if (!ReadStatus(pid, status)) {
+    return "";
+  }
+  return UserName(status.uid);
+}
+
+/**
+ * @brief Looks up the username of a UID in /etc/passwd.
+ *
+ * The file is parsed into a map once and only parsed again after it was
+ * modified, so a lookup costs one stat instead of a scan of the file.
+ *
+ * @param uid int: The UID, as read by ReadStatus.
+ * @return std::string: The username, or an empty string if the UID has none.
+ */
+std::string LinuxParser::UserName(int uid) {
+  static std::unordered_map<int, std::string> users;
+  static struct stat loaded {};
+  struct stat current {};
+  if (stat(kPasswordPath.c_str(), &current) == 0 &&
+      (current.st_mtim.tv_sec != loaded.st_mtim.tv_sec ||
+       current.st_mtim.tv_nsec != loaded.st_mtim.tv_nsec ||
+       current.st_ino != loaded.st_ino || current.st_size != loaded.st_size)) {
+    loaded = current;
+    users.clear();
+    std::ifstream file_stream(kPasswordPath);
     std::string line;
-    while(std::getline(file_stream, line)){
+    while (std::getline(file_stream, line)) {
       std::istringstream linestream(line);
       std::string user_name, x, file_uid;
-       // Read the username
+      // name:password:UID:...
       std::getline(linestream, user_name, ':');
-      // Read the 'x' (password placeholder)
       std::getline(linestream, x, ':');
-      // Read the UID
       std::getline(linestream, file_uid, ':');
-      // Ignore the rest of the line
-      if(file_uid == uid){
-        return user_name;
+      char* end{nullptr};
+      long const id = std::strtol(file_uid.c_str(), &end, 10);
+      // The first entry of a UID wins, as with getpwuid
+      if (!file_uid.empty() && *end == '\0') {
+        users.emplace(static_cast<int>(id), user_name);
       }
     }
-  }  
-  return ""; 
+  }
+  auto user = users.find(uid);
+  return user == users.end() ? "" : user->second;
 }
 
-
-
 /**
  * @brief Get the uptime of a process in seconds.
  *
@@ -458,21 +585,318 @@ std::string LinuxParser::User(int pid) {
  * @param pid int: The process ID for which to get the uptime.
  * @return long: The uptime of the process in seconds. If the file cannot be opened, returns 0.
  */
-long LinuxParser::UpTime(int pid) { 
-  std::ifstream file_stream(kProcDirectory + std::to_string(pid) + kStatFilename);
-  if (file_stream) {
-    std::string line;
-    std::getline(file_stream, line);
-    std::istringstream linestream(line);
-    std::string value;
-    long starttime;
-    for (int i = 1; i <= 22; ++i) {
+long LinuxParser::UpTime(int pid) {
+  long starttime = StartTime(pid);
+  if (starttime == 0) {
+    return 0;
+  }
+  // no matter the start time is expressed either in jiffies (before linux 2.6) or clock ticks (after linux 2.6), we simply convert it to seconds
+  starttime /= sysconf(_SC_CLK_TCK); // convert clock ticks to seconds by dividing by the frequency (Hertz).
+  return LinuxParser::UpTime() - starttime; // subtract the process start time from the system uptime to get the process uptime
+}
+
+
+/**
+ * @brief Get the start time of a process in clock ticks since boot.
+ *
+ * This function reads the starttime field (22) of the /proc/[pid]/stat file.
+ * Together with the PID it identifies a process even if the PID is reused.
+ *
+ * @param pid int: The process ID for which to get the start time.
+ * @return long: The start time in clock ticks. If the file cannot be opened, returns 0.
+ */
+long LinuxParser::StartTime(int pid) {
+  ProcFields::Record<ProcFields::StatSchema, ProcFields::Stat::kStartTime> stat;
+  if (!ReadFields(pid, kStatFilename, stat)) {
+    return 0;
+  }
+  return stat.Get<ProcFields::Stat::kStartTime>();
+}
+
+
+/**
+ * @brief Get the scheduling state of a process.
+ *
+ * This function reads the state field (3) of the /proc/[pid]/stat file, e.g. 'R'
+ * for running, 'S' for sleeping or 'Z' for zombie.
+ *
+ * @param pid int: The process ID for which to get the state.
+ * @return char: The state of the process. If the file cannot be opened, returns '?'.
+ */
+char LinuxParser::State(int pid) {
+  ProcFields::Record<ProcFields::StatSchema, ProcFields::Stat::kState> stat;
+  if (!ReadFields(pid, kStatFilename, stat)) {
+    return '?';
+  }
+  return stat.Get<ProcFields::Stat::kState>();
+}
+
+
+/**
+ * @brief Get the resident set size of a process.
+ *
+ * This function reads the resident field (2) of the /proc/[pid]/statm file, which
+ * counts pages, and converts it to KB.
+ *
+ * @param pid int: The process ID for which to get the resident set size.
+ * @return long: The resident set size in KB. If the file cannot be opened, returns 0.
+ */
+long LinuxParser::Rss(int pid) {
+  ProcFields::Record<ProcFields::StatmSchema, ProcFields::Statm::kResident>
+      statm;
+  if (!ReadFields(pid, kStatmFilename, statm)) {
+    return 0;
+  }
+  return statm.Get<ProcFields::Statm::kResident>() *
+         (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/**
+ * @brief Reads the jiffies of every CPU from the /proc/stat file.
+ *
+ * The per-CPU lines follow the aggregate "cpu" line; their active and total
+ * jiffies are summed the same way as by ActiveJiffies and Jiffies. CPUs that
+ * are offline have no line.
+ *
+ * @param cores std::vector<CoreJiffies>&: Receives one entry per online CPU,
+ *        in the order of the file.
+ * @return bool: True if the file could be read, false otherwise.
+ */
+bool LinuxParser::ReadCoreJiffies(std::vector<CoreJiffies>& cores) {
+  cores.clear();
+  std::ifstream file_stream(kProcDirectory + kStatFilename);
+  if (!file_stream) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file_stream, line)) {
+    if (line.rfind("cpu", 0) != 0) {
+      break;
+    }
+    if (line.size() < 4 || line[3] < '0' || line[3] > '9') {
+      continue;  // the aggregate line
+    }
+    std::istringstream linestream(line.substr(3));
+    long values[kGuest_]{};
+    CoreJiffies core;
+    linestream >> core.cpu;
+    for (long& value : values) {
       linestream >> value;
-      if (i == 22) starttime = std::stol(value);
     }
-    // no matter the start time is expressed either in jiffies (before linux 2.6) or clock ticks (after linux 2.6), we simply convert it to seconds
-    starttime /= sysconf(_SC_CLK_TCK); // convert clock ticks to seconds by dividing by the frequency (Hertz).
-    return LinuxParser::UpTime() - starttime; // subtract the process start time from the system uptime to get the process uptime
+    core.active = values[kUser_] + values[kNice_] + values[kSystem_] +
+                  values[kIRQ_] + values[kSoftIRQ_] + values[kSteal_];
+    core.total = core.active + values[kIdle_] + values[kIOwait_];
+    cores.push_back(core);
+  }
+  return true;
+}
+
+// Take the next range of a list like "0-3,8" off its front, a single number
+// being a range of one; return false at the end or if the list is malformed
+static bool NextRange(std::string_view& text, int& first, int& last,
+                      bool& malformed) {
+  // Read a number at the front of the text, return false if there is none
+  auto number = [&text](int& value) {
+    std::size_t digits{0};
+    value = 0;
+    for (; digits < text.size() && text[digits] >= '0' && text[digits] <= '9' &&
+           digits < 9;
+         ++digits) {
+      value = value * 10 + (text[digits] - '0');
+    }
+    text.remove_prefix(digits);
+    return digits > 0;
+  };
+  while (!text.empty() &&
+         std::isspace(static_cast<unsigned char>(text.back()))) {
+    text.remove_suffix(1);
+  }
+  malformed = false;
+  if (text.empty()) {
+    return false;
+  }
+  malformed = true;
+  if (!number(first)) {
+    return false;
+  }
+  last = first;
+  if (!text.empty() && text.front() == '-') {
+    text.remove_prefix(1);
+    if (!number(last) || last < first) {
+      return false;
+    }
+  }
+  if (!text.empty()) {
+    if (text.front() != ',') {
+      return false;
+    }
+    text.remove_prefix(1);
+  }
+  malformed = false;
+  return true;
+}
+
+/**
+ * @brief Parses a list of numbers and ranges as used by sysfs, e.g. "0-3,8".
+ *
+ * @param text std::string_view: The list, trailing whitespace is ignored.
+ * @param numbers std::vector<int>&: Receives the numbers in ascending order
+ *        of the list.
+ * @return bool: True if the list is well-formed, false otherwise.
+ */
+bool LinuxParser::ParseList(std::string_view text, std::vector<int>& numbers) {
+  numbers.clear();
+  int first;
+  int last;
+  bool malformed;
+  while (NextRange(text, first, last, malformed)) {
+    for (int i = first; i <= last; ++i) {
+      numbers.push_back(i);
+    }
+  }
+  return !malformed;
+}
+
+// Return whether a list like "0-3,8" contains a number, without expanding it
+bool LinuxParser::ListContains(std::string_view text, int number) {
+  int first;
+  int last;
+  bool malformed;
+  while (NextRange(text, first, last, malformed)) {
+    if (number >= first && number <= last) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Read a small sysfs file into a string, return false if it cannot be read
+static bool ReadSysfsFile(std::string const& path, std::string& text) {
+  std::ifstream file_stream(path);
+  if (!file_stream) {
+    return false;
+  }
+  text.assign(std::istreambuf_iterator<char>(file_stream),
+              std::istreambuf_iterator<char>());
+  return true;
+}
+
+/**
+ * @brief Lists the online NUMA nodes.
+ *
+ * @param nodes std::vector<int>&: Receives the node IDs in ascending order.
+ * @return bool: True if the nodes are known, false if the kernel was built
+ *         without NUMA support.
+ */
+bool LinuxParser::Nodes(std::vector<int>& nodes) {
+  std::string text;
+  return ReadSysfsFile(kNodeDirectory + kOnlineFilename, text) &&
+         ParseList(text, nodes);
+}
+
+/**
+ * @brief Lists the CPUs of a NUMA node.
+ *
+ * @param node int: The node ID.
+ * @param cpus std::vector<int>&: Receives the CPU IDs in ascending order,
+ *        empty for a node with memory only.
+ * @return bool: True if the list could be read, false otherwise.
+ */
+bool LinuxParser::NodeCpus(int node, std::vector<int>& cpus) {
+  std::string text;
+  return ReadSysfsFile(kNodeDirectory + "node" + std::to_string(node) +
+                           kCpulistFilename,
+                       text) &&
+         ParseList(text, cpus);
+}
+
+/**
+ * @brief Reads the memory of a NUMA node from its meminfo file.
+ *
+ * Every line reads "Node N Key: value kB"; only the keys needed to tell the
+ * memory in use apart from free memory and caches are kept.
+ *
+ * @param node int: The node ID.
+ * @param memory NodeMemory&: Receives the memory of the node in KB.
+ * @return bool: True if the file could be read, false otherwise.
+ */
+bool LinuxParser::ReadNodeMemory(int node, NodeMemory& memory) {
+  std::ifstream file_stream(kNodeDirectory + "node" + std::to_string(node) +
+                            kMeminfoFilename);
+  if (!file_stream) {
+    return false;
+  }
+  memory = NodeMemory{};
+  std::string line;
+  while (std::getline(file_stream, line)) {
+    std::istringstream linestream(line);
+    std::string prefix;
+    int id;
+    std::string key;
+    long value{0};
+    linestream >> prefix >> id >> key >> value;
+    if (key == "MemTotal:") {
+      memory.total = value;
+    } else if (key == "MemFree:") {
+      memory.free = value;
+    } else if (key == "FilePages:") {
+      memory.file_pages = value;
+    } else if (key == "SReclaimable:") {
+      memory.reclaimable = value;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Sums the memory of a process per NUMA node from its numa_maps file.
+ *
+ * Every mapping lists its pages per node as "N<node>=<pages>" along with the
+ * size of its pages, so huge pages are counted by their real size. The file
+ * walks the page tables of every mapping and is expensive for large
+ * processes, so it is only read on request, never per tick.
+ *
+ * @param pid int: The process ID.
+ * @param kilobytes std::vector<long>&: Receives the KB per node, indexed by
+ *        node ID.
+ * @return bool: True if the file could be read, false if the process is gone
+ *         or belongs to another user.
+ */
+bool LinuxParser::NumaPages(int pid, std::vector<long>& kilobytes) {
+  kilobytes.clear();
+  std::ifstream file_stream(kProcDirectory + std::to_string(pid) +
+                            kNumaMapsFilename);
+  if (!file_stream) {
+    return false;
+  }
+  std::string line;
+  std::vector<std::pair<int, long>> pages;
+  while (std::getline(file_stream, line)) {
+    std::istringstream linestream(line);
+    std::string token;
+    long page_size{0};
+    pages.clear();
+    while (linestream >> token) {
+      std::size_t const equals = token.find('=');
+      if (equals == std::string::npos) {
+        continue;
+      }
+      if (token[0] == 'N' && equals > 1) {
+        pages.emplace_back(std::atoi(token.c_str() + 1),
+                           std::atol(token.c_str() + equals + 1));
+      } else if (token.compare(0, equals, "kernelpagesize_kB") == 0) {
+        page_size = std::atol(token.c_str() + equals + 1);
+      }
+    }
+    for (auto const& [node, count] : pages) {
+      if (node < 0) {
+        continue;
+      }
+      if (static_cast<std::size_t>(node) >= kilobytes.size()) {
+        kilobytes.resize(node + 1, 0);
+      }
+      kilobytes[node] += count * page_size;
+    }
   }
-  return 0; 
+  return !file_stream.bad();
 }
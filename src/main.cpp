@@ -1,7 +1,182 @@
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "batch_display.h"
+#include "exporter.h"
 #include "ncurses_display.h"
+#include "options.h"
+#include "refresh_scheduler.h"
+#include "rule_engine.h"
+#include "shared_snapshot.h"
+#include "snapshot_source.h"
+#include "snapshot_stream.h"
+#include "socket_address.h"
 #include "system.h"
 
-int main() {
+// Wait for the next tick, return false once one of the blocked signals came
+static bool WaitForTick(RefreshScheduler const& scheduler,
+                        sigset_t const& signals) {
+  while (1) {
+    auto remaining = scheduler.Remaining();
+    if (remaining.count() == 0) {
+      return true;
+    }
+    timespec timeout{};
+    timeout.tv_sec = remaining.count() / 1000;
+    timeout.tv_nsec = (remaining.count() % 1000) * 1000000;
+    if (sigtimedwait(&signals, nullptr, &timeout) >= 0) {
+      return false;
+    }
+    if (errno != EAGAIN && errno != EINTR) {
+      return true;
+    }
+  }
+}
+
+// Sample the source every tick and hand the snapshot to the publishers until
+// SIGINT or SIGTERM, so the destructors remove the segment and the socket.
+// With rows beyond k, the sender picks its top k by CPU from all of them.
+static void Publish(SnapshotSource& source, RefreshScheduler& scheduler,
+                    std::size_t k, std::size_t rows, Exporter* exporter,
+                    SharedSnapshotWriter* writer, SnapshotSender* sender,
+                    sigset_t const& signals) {
+  Snapshot snapshot;
+  while (1) {
+    scheduler.BeginTick();
+    source.Sample(snapshot, rows);
+    scheduler.Observe(snapshot.system.cpu);
+    scheduler.Observe(snapshot.system.memory);
+    if (sender != nullptr) {
+      sender->Publish(snapshot);
+    }
+    if (snapshot.processes.size() > k) {
+      snapshot.processes.resize(k);
+    }
+    if (exporter != nullptr) {
+      exporter->Publish(snapshot);
+    }
+    if (writer != nullptr) {
+      writer->Publish(snapshot);
+    }
+    scheduler.EndTick();
+    if (!WaitForTick(scheduler, signals)) {
+      return;
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!CommandLine::Parse(argc, argv, options)) {
+    std::cerr << CommandLine::Usage(argv[0]);
+    return 1;
+  }
+  RefreshScheduler scheduler{std::chrono::milliseconds{options.min_interval_ms},
+                             std::chrono::milliseconds{options.max_interval_ms},
+                             options.cpu_cap};
+  std::string error;
+  for (std::string const* address : {&options.export_address,
+                                     &options.send_address,
+                                     &options.collect_address}) {
+    if (!address->empty() && !SocketAddress::Check(*address, error)) {
+      std::cerr << "Invalid address '" << *address << "': " << error << "\n";
+      return 1;
+    }
+  }
+  bool const publish = !options.export_address.empty() ||
+                       !options.publish_name.empty() ||
+                       !options.send_address.empty();
+  // A publisher blocks the stop signals before any thread starts and takes
+  // them while waiting for the next tick instead
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  if (publish) {
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  }
   System system;
-  NCursesDisplay::Display(system);
-}
\ No newline at end of file
+  if (!options.filter.empty() && !system.SetFilter(options.filter, error)) {
+    std::cerr << "Invalid filter: " << error << "\n";
+    return 1;
+  }
+  if (!options.sort.empty() && !system.SetSort(options.sort, error)) {
+    std::cerr << "Invalid sort column: " << error << "\n";
+    return 1;
+  }
+  if (options.io_uring && !system.UseBatchReads()) {
+    std::cerr << "io_uring is not available, reading /proc synchronously\n";
+  }
+  SnapshotSource* source = &system;
+  SharedSnapshotReader reader;
+  if (!options.attach_name.empty()) {
+    if (!reader.Attach(options.attach_name, error)) {
+      std::cerr << "Cannot attach: " << error << "\n";
+      return 1;
+    }
+    source = &reader;
+  }
+  SnapshotCollector collector{options.collect_address};
+  if (!options.collect_address.empty()) {
+    if (!collector.Start()) {
+      std::cerr << "Cannot listen on " << options.collect_address << "\n";
+      return 1;
+    }
+    source = &collector;
+  }
+  // Rules are evaluated wherever the snapshots end up
+  RuleEngine rules{*source, options.alert_hook};
+  for (std::string const& rule : options.rules) {
+    if (!rules.AddRule(rule, error)) {
+      std::cerr << "Invalid rule '" << rule << "': " << error << "\n";
+      return 1;
+    }
+  }
+  if (!options.rules.empty()) {
+    source = &rules;
+  }
+
+  if (publish) {
+    Exporter exporter{options.export_address};
+    if (!options.export_address.empty() && !exporter.Start()) {
+      std::cerr << "Cannot listen on " << options.export_address << "\n";
+      return 1;
+    }
+    SharedSnapshotWriter writer;
+    if (!options.publish_name.empty() &&
+        !writer.Open(options.publish_name, options.top)) {
+      std::cerr << "Cannot publish under " << options.publish_name << "\n";
+      return 1;
+    }
+    if (options.host_name.empty()) {
+      char name[256]{};
+      gethostname(name, sizeof(name) - 1);
+      options.host_name = name;
+    }
+    SnapshotSender sender{options.send_address, options.host_name,
+                          options.top};
+    // The collector ranks by CPU, another local ranking may leave out the
+    // busiest processes, so the sender then gets all of them
+    bool const by_cpu = options.sort.empty() || options.sort == "cpu";
+    std::size_t const rows = options.send_address.empty() || by_cpu
+                                 ? options.top
+                                 : std::numeric_limits<std::size_t>::max();
+    Publish(*source, scheduler, options.top, rows,
+            options.export_address.empty() ? nullptr : &exporter,
+            options.publish_name.empty() ? nullptr : &writer,
+            options.send_address.empty() ? nullptr : &sender, signals);
+    return 0;
+  }
+
+  if (options.batch) {
+    BatchDisplay::Display(*source, scheduler, std::cout);
+  }
+  NCursesDisplay::Display(*source, scheduler);
+}
@@ -1,12 +1,13 @@
 #include <curses.h>
-#include <chrono>
+#include <algorithm>
+#include <clocale>
+#include <iterator>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "format.h"
+#include "history.h"
 #include "ncurses_display.h"
-#include "system.h"
 
 using std::string;
 using std::to_string;
@@ -28,83 +29,439 @@ std::string NCursesDisplay::ProgressBar(float percent) {
   return result + " " + display + "/100%";
 }
 
-void NCursesDisplay::DisplaySystem(System& system, WINDOW* window) {
+// Draw a sparkline at the given position, clipped to the window's border
+static void DrawSparkline(WINDOW* window, int row, int column,
+                          std::vector<std::uint8_t> const& samples, int scale,
+                          std::size_t width) {
+  int const room = getmaxx(window) - 1 - column;
+  if (room > 0) {
+    width = std::min<std::size_t>(width, room);
+    mvwaddstr(window, row, column,
+              Format::Sparkline(samples, scale, width).c_str());
+  }
+}
+
+void NCursesDisplay::DisplaySystem(SystemRecord const& system,
+                                   RefreshScheduler const& scheduler,
+                                   WINDOW* window) {
   int row{0};
-  mvwprintw(window, ++row, 2, ("OS: " + system.OperatingSystem()).c_str());
-  mvwprintw(window, ++row, 2, ("Kernel: " + system.Kernel()).c_str());
+  int const history_column{74};
+  mvwprintw(window, ++row, 2, "OS: %s", system.operating_system.c_str());
+  mvwprintw(window, ++row, 2, "Kernel: %s", system.kernel.c_str());
   mvwprintw(window, ++row, 2, "CPU: ");
   wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.Cpu().Utilization()).c_str());
+  mvwprintw(window, row, 10, "%s", ProgressBar(system.cpu).c_str());
+  DrawSparkline(window, row, history_column, system.cpu_history, 100,
+                kSystemHistory);
   wattroff(window, COLOR_PAIR(1));
   mvwprintw(window, ++row, 2, "Memory: ");
   wattron(window, COLOR_PAIR(1));
-  mvwprintw(window, row, 10, "");
-  wprintw(window, ProgressBar(system.MemoryUtilization()).c_str());
+  mvwprintw(window, row, 10, "%s", ProgressBar(system.memory).c_str());
+  DrawSparkline(window, row, history_column, system.memory_history, 100,
+                kSystemHistory);
   wattroff(window, COLOR_PAIR(1));
-  mvwprintw(window, ++row, 2,
-            ("Total Processes: " + to_string(system.TotalProcesses())).c_str());
-  mvwprintw(
-      window, ++row, 2,
-      ("Running Processes: " + to_string(system.RunningProcesses())).c_str());
-  mvwprintw(window, ++row, 2,
-            ("Up Time: " + Format::ElapsedTime(system.UpTime())).c_str());
+  mvwprintw(window, ++row, 2, "Total Processes: %d", system.total_processes);
+  mvwprintw(window, ++row, 2, "Running Processes: %d",
+            system.running_processes);
+  mvwprintw(window, ++row, 2, "Up Time: %s",
+            Format::ElapsedTime(system.uptime).c_str());
+  // The adaptive interval and what sampling costs the monitor itself
+  mvwprintw(window, row, 30, "Refresh: %5ld ms  Self: %5.1f%% CPU",
+            static_cast<long>(scheduler.Interval().count()),
+            scheduler.SelfCpuShare() * 100);
   wrefresh(window);
 }
 
-void NCursesDisplay::DisplayProcesses(std::vector<Process>& processes,
-                                      WINDOW* window, int n) {
+void NCursesDisplay::DisplayProcesses(
+    std::vector<ProcessRecord> const& processes, std::string const& sort,
+    int selected, WINDOW* window, int n) {
   int row{0};
   int const pid_column{2};
   int const user_column{9};
   int const cpu_column{16};
-  int const ram_column{26};
-  int const time_column{35};
-  int const command_column{46};
+  int const wait_column{23};
+  int const history_column{31};
+  int const ram_column{48};
+  int const voluntary_column{56};
+  int const involuntary_column{63};
+  int const processor_column{70};
+  int const migrations_column{76};
+  int const time_column{82};
+  int const command_column{93};
+  // The header of the column the processes are ranked by is highlighted
+  auto header = [&](int column, char const* name, char const* key) {
+    bool const sorted = sort == key;
+    if (sorted) {
+      wattron(window, A_REVERSE);
+    }
+    mvwaddstr(window, row, column, name);
+    if (sorted) {
+      wattroff(window, A_REVERSE);
+    }
+  };
   wattron(window, COLOR_PAIR(2));
   mvwprintw(window, ++row, pid_column, "PID");
   mvwprintw(window, row, user_column, "USER");
-  mvwprintw(window, row, cpu_column, "CPU[%%]");
+  header(cpu_column, "CPU[%]", "cpu");
+  header(wait_column, "WAIT[%]", "wait");
+  mvwprintw(window, row, history_column, "HISTORY");
   mvwprintw(window, row, ram_column, "RAM[MB]");
+  header(voluntary_column, "VOL/s", "voluntary");
+  header(involuntary_column, "INV/s", "involuntary");
+  mvwprintw(window, row, processor_column, "LAST");
+  mvwprintw(window, row, migrations_column, "MIG");
   mvwprintw(window, row, time_column, "TIME+");
   mvwprintw(window, row, command_column, "COMMAND");
   wattroff(window, COLOR_PAIR(2));
   int const num_processes = int(processes.size()) > n ? n : processes.size();
   for (int i = 0; i < num_processes; ++i) {
-    mvwprintw(window, ++row, pid_column, to_string(processes[i].Pid()).c_str());
-    mvwprintw(window, row, user_column, processes[i].User().c_str());
-    float cpu = processes[i].CpuUtilization() * 100;
-    mvwprintw(window, row, cpu_column, to_string(cpu).substr(0, 4).c_str());
-    mvwprintw(window, row, ram_column, processes[i].Ram().c_str());
-    mvwprintw(window, row, time_column,
-              Format::ElapsedTime(processes[i].UpTime()).c_str());
-    mvwprintw(window, row, command_column,
-              processes[i].Command().substr(0, window->_maxx - 46).c_str());
+    mvwprintw(window, ++row, pid_column, "%d", processes[i].pid);
+    mvwprintw(window, row, user_column, "%s", processes[i].user.c_str());
+    float cpu = processes[i].cpu * 100;
+    mvwprintw(window, row, cpu_column, "%s",
+              to_string(cpu).substr(0, 4).c_str());
+    float wait = processes[i].wait * 100;
+    mvwprintw(window, row, wait_column, "%s",
+              to_string(wait).substr(0, 4).c_str());
+    // Scaled to the row's peak, so the shape shows even for light loads
+    std::vector<std::uint8_t> const& history = processes[i].cpu_history;
+    int const peak = history.empty()
+                         ? 1
+                         : *std::max_element(history.begin(), history.end());
+    DrawSparkline(window, row, history_column, history, std::max(peak, 1),
+                  kProcessHistory);
+    mvwprintw(window, row, ram_column, "%ld", processes[i].ram);
+    mvwprintw(window, row, voluntary_column, "%.0f",
+              processes[i].voluntary_switches);
+    mvwprintw(window, row, involuntary_column, "%.0f",
+              processes[i].involuntary_switches);
+    mvwaddstr(window, row, processor_column,
+              Format::Processor(processes[i]).c_str());
+    mvwprintw(window, row, migrations_column, "%ld", processes[i].migrations);
+    mvwprintw(window, row, time_column, "%s",
+              Format::ElapsedTime(processes[i].uptime).c_str());
+    std::string command = processes[i].command;
+    if (!processes[i].host.empty()) {
+      command = "[" + processes[i].host + "] " + command;
+    }
+    int const room = window->_maxx - command_column;
+    if (room > 0) {
+      mvwaddnstr(window, row, command_column, command.c_str(), room);
+    }
+    if (i == selected) {
+      mvwchgat(window, row, 1, getmaxx(window) - 2, A_REVERSE, 0, nullptr);
+    }
+  }
+}
+
+/**
+ * @brief Shows the memory and the CPUs of every NUMA node, two rows each.
+ *
+ * The CPUs of a node are drawn as one block per CPU by its load, so an
+ * imbalance between the nodes shows at a glance. Below them a heatmap shows
+ * how many processes were active on each CPU, hotter the more there were.
+ * CPUs beyond the window's border are left out.
+ *
+ * @param nodes std::vector<NodeRecord>: The nodes, nothing is shown if empty.
+ * @param window WINDOW*: The node window.
+ */
+void NCursesDisplay::DisplayNodes(std::vector<NodeRecord> const& nodes,
+                                  WINDOW* window) {
+  int row{0};
+  int const memory_column{10};
+  int const cpu_column{36};
+  int const list_column{49};
+  int const cores_column{64};
+  std::vector<std::uint8_t> cores;
+  for (NodeRecord const& node : nodes) {
+    mvwprintw(window, ++row, 2, "Node %d", node.id);
+    mvwprintw(window, row, memory_column, "Memory %5.1f%% of %ldM",
+              node.memory * 100, node.memory_total);
+    mvwprintw(window, row, cpu_column, "CPU %5.1f%%", node.cpu * 100);
+    std::string const list = Format::List(node.cpus);
+    mvwaddnstr(window, row, list_column, list.c_str(),
+               cores_column - list_column - 1);
+    // An idle CPU still shows as the lowest block
+    int const room = getmaxx(window) - 1 - cores_column;
+    cores.assign(node.cores.begin(),
+                 node.cores.begin() + std::clamp<int>(room, 0,
+                                                      node.cores.size()));
+    for (std::uint8_t& core : cores) {
+      core = std::max<std::uint8_t>(core, 1);
+    }
+    wattron(window, COLOR_PAIR(1));
+    mvwaddstr(window, row, cores_column,
+              Format::Sparkline(cores, 100, cores.size()).c_str());
+    wattroff(window, COLOR_PAIR(1));
+
+    int active{0};
+    for (std::uint8_t const processes : node.occupancy) {
+      active += processes;
+    }
+    mvwprintw(window, ++row, cpu_column, "Active %d", active);
+    for (std::size_t j = 0; j < cores.size() && j < node.occupancy.size();
+         ++j) {
+      int const processes = node.occupancy[j];
+      int const pair = processes == 0   ? 0
+                       : processes == 1 ? 3
+                       : processes == 2 ? 4
+                                        : 5;
+      char const cell = processes == 0  ? '.'
+                        : processes > 9 ? '+'
+                                        : static_cast<char>('0' + processes);
+      wattron(window, COLOR_PAIR(pair));
+      mvwaddch(window, row, cores_column + j, cell);
+      wattroff(window, COLOR_PAIR(pair));
+    }
+  }
+}
+
+/**
+ * @brief Describes the memory of a process per NUMA node for the status line.
+ *
+ * @param pid int: The process ID.
+ * @param kilobytes std::vector<long>: The KB per node, indexed by node ID.
+ * @return std::string: E.g. "PID 42: node 0 812M 80%, node 1 203M 20%".
+ */
+static std::string NumaMessage(int pid, std::vector<long> const& kilobytes) {
+  long total{0};
+  for (long const node : kilobytes) {
+    total += node;
+  }
+  std::string message = "PID " + to_string(pid) + ":";
+  if (total == 0) {
+    return message + " no pages on any node";
+  }
+  for (std::size_t node = 0; node < kilobytes.size(); ++node) {
+    if (kilobytes[node] == 0) {
+      continue;
+    }
+    message += (message.back() == ':' ? " node " : ", node ") +
+               to_string(node) + " " + to_string(kilobytes[node] / 1024) +
+               "M " + to_string(kilobytes[node] * 100 / total) + "%";
+  }
+  return message;
+}
+
+/**
+ * @brief Shows the hosts of a collected snapshot in place of the kernel.
+ *
+ * @param hosts std::vector<HostRecord>: The hosts the snapshot was merged
+ *        from, nothing is shown if empty.
+ * @param window WINDOW*: The system window.
+ */
+void NCursesDisplay::DisplayHosts(std::vector<HostRecord> const& hosts,
+                                  WINDOW* window) {
+  if (hosts.empty()) {
+    return;
+  }
+  std::string line{"Hosts:"};
+  for (HostRecord const& host : hosts) {
+    line += " " + host.name + " " + to_string(host.cpu * 100).substr(0, 4) +
+            "%";
+  }
+  // Padded to cover the kernel line, short of the window's border
+  int const width = getmaxx(window) - 3;
+  if (width > 0) {
+    line.resize(width, ' ');
+    mvwaddstr(window, 2, 2, line.c_str());
   }
+  wrefresh(window);
+}
+
+/**
+ * @brief Shows the current filter, or a message, in the status line.
+ *
+ * @param filter std::string: The expression the processes are filtered with.
+ * @param message std::string: An error or the latest alert to show instead,
+ *        if not empty.
+ * @param window WINDOW*: The status line.
+ */
+void NCursesDisplay::DisplayStatus(std::string const& filter,
+                                   std::string const& message,
+                                   WINDOW* window) {
+  werase(window);
+  if (!message.empty()) {
+    mvwprintw(window, 0, 2, "%s", message.c_str());
+  } else if (!filter.empty()) {
+    mvwprintw(window, 0, 2, "Filter: %s", filter.c_str());
+  } else {
+    mvwprintw(window, 0, 2,
+              "Press / to filter, s to sort, arrows and n for the NUMA "
+              "pages of a process");
+  }
+  wrefresh(window);
+}
+
+// Return the sort column following the given one, wrapping around
+static std::string NextSortColumn(std::string const& column) {
+  std::size_t const count = std::size(kSortColumns);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (column == kSortColumns[i]) {
+      return kSortColumns[(i + 1) % count];
+    }
+  }
+  return kSortColumns[0];
+}
+
+/**
+ * @brief Reads a new filter expression in the status line.
+ *
+ * Input is echoed and blocking while the prompt is open, and the previous
+ * settings are restored afterwards.
+ *
+ * @param current std::string: The current expression, shown as a hint.
+ * @param window WINDOW*: The status line.
+ * @return std::string: The entered expression, empty to show all processes.
+ */
+std::string NCursesDisplay::PromptFilter(std::string const& current,
+                                         WINDOW* window) {
+  werase(window);
+  if (!current.empty()) {
+    mvwprintw(window, 0, 2, "Filter (was %s): ", current.c_str());
+  } else {
+    mvwprintw(window, 0, 2, "Filter: ");
+  }
+  echo();
+  curs_set(1);
+  timeout(-1);
+  char input[256]{};
+  wgetnstr(window, input, sizeof(input) - 1);
+  curs_set(0);
+  noecho();
+  return input;
 }
 
-void NCursesDisplay::Display(System& system, int n) {
+void NCursesDisplay::Display(SnapshotSource& source,
+                             RefreshScheduler& scheduler, int n) {
+  setlocale(LC_ALL, "");  // the sparklines are UTF-8
   initscr();      // start ncurses
   noecho();       // do not print input values
   cbreak();       // terminate ncurses on ctrl + c
   start_color();  // enable color
+  curs_set(0);
+
+  keypad(stdscr, TRUE);  // arrow keys move the selection
 
   int x_max{getmaxx(stdscr)};
   WINDOW* system_window = newwin(9, x_max - 1, 0, 0);
-  WINDOW* process_window =
-      newwin(3 + n, x_max - 1, system_window->_maxy + 1, 0);
+  // The node window only exists while the source has NUMA nodes, the windows
+  // below it move whenever their number changes
+  WINDOW* node_window{nullptr};
+  WINDOW* process_window{nullptr};
+  WINDOW* status_window{nullptr};
+  std::size_t node_count{0};
+  auto layout = [&](std::size_t nodes) {
+    for (WINDOW* window : {node_window, process_window, status_window}) {
+      if (window != nullptr) {
+        delwin(window);
+      }
+    }
+    node_window = nullptr;
+    int top = getmaxy(system_window);
+    if (nodes > 0) {
+      node_window = newwin(2 * nodes + 2, x_max - 1, top, 0);
+      top += 2 * nodes + 2;
+    }
+    process_window = newwin(3 + n, x_max - 1, top, 0);
+    status_window = newwin(1, x_max - 1, top + 3 + n, 0);
+    node_count = nodes;
+    erase();
+    refresh();
+  };
+  layout(0);
 
+  Snapshot snapshot;
+  std::string message;
+  // Row of the selected process, kept within the rows shown. The selection
+  // follows its process when the ranking changes, while the process is shown.
+  int selected{0};
+  int selected_pid{0};
+  auto shown = [&]() { return std::min<int>(snapshot.processes.size(), n); };
+  auto draw_processes = [&]() {
+    selected = std::clamp(selected, 0, std::max(shown() - 1, 0));
+    selected_pid = selected < shown() ? snapshot.processes[selected].pid : 0;
+    werase(process_window);
+    box(process_window, 0, 0);
+    DisplayProcesses(snapshot.processes, snapshot.system.sort, selected,
+                     process_window, n);
+    wrefresh(process_window);
+  };
   while (1) {
+    scheduler.BeginTick();
+    source.Sample(snapshot, n);
+    // The change rate of these metrics drives the refresh interval
+    scheduler.Observe(snapshot.system.cpu);
+    scheduler.Observe(snapshot.system.memory);
     init_pair(1, COLOR_BLUE, COLOR_BLACK);
     init_pair(2, COLOR_GREEN, COLOR_BLACK);
+    // Levels of the occupancy heatmap
+    init_pair(3, COLOR_BLACK, COLOR_GREEN);
+    init_pair(4, COLOR_BLACK, COLOR_YELLOW);
+    init_pair(5, COLOR_WHITE, COLOR_RED);
+    for (int row = 0; row < shown(); ++row) {
+      if (snapshot.processes[row].pid == selected_pid) {
+        selected = row;
+      }
+    }
+    if (snapshot.nodes.size() != node_count) {
+      layout(snapshot.nodes.size());
+    }
     box(system_window, 0, 0);
-    box(process_window, 0, 0);
-    DisplaySystem(system, system_window);
-    DisplayProcesses(system.Processes(), process_window, n);
+    DisplaySystem(snapshot.system, scheduler, system_window);
+    DisplayHosts(snapshot.hosts, system_window);
     wrefresh(system_window);
-    wrefresh(process_window);
+    if (node_window != nullptr) {
+      werase(node_window);
+      box(node_window, 0, 0);
+      DisplayNodes(snapshot.nodes, node_window);
+      wrefresh(node_window);
+    }
+    draw_processes();
+    if (!snapshot.alerts.empty()) {
+      message = Format::Alert(snapshot.alerts.back());
+    }
+    DisplayStatus(snapshot.system.filter, message, status_window);
     refresh();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    scheduler.EndTick();
+
+    // Wait for the next tick, a new filter or sort samples again right away
+    for (long remaining = scheduler.Remaining().count(); remaining > 0;
+         remaining = scheduler.Remaining().count()) {
+      timeout(remaining);
+      int const key = getch();
+      if (key == '/') {
+        std::string expression =
+            PromptFilter(snapshot.system.filter, status_window);
+        message.clear();
+        if (!source.SetFilter(expression, message)) {
+          message = "Invalid filter: " + message;
+        }
+        break;
+      }
+      if (key == 's') {
+        message.clear();
+        if (!source.SetSort(NextSortColumn(snapshot.system.sort), message)) {
+          message = "Cannot sort: " + message;
+        }
+        break;
+      }
+      if (key == KEY_UP || key == KEY_DOWN) {
+        selected += key == KEY_UP ? -1 : 1;
+        draw_processes();
+      }
+      // numa_maps is expensive, so it is only read for the selected process
+      // when asked for
+      if (key == 'n' && selected < shown()) {
+        int const pid = snapshot.processes[selected].pid;
+        std::vector<long> kilobytes;
+        std::string error;
+        message = source.NumaPages(pid, kilobytes, error)
+                      ? NumaMessage(pid, kilobytes)
+                      : "Cannot read the NUMA pages: " + error;
+        DisplayStatus(snapshot.system.filter, message, status_window);
+      }
+    }
   }
   endwin();
 }
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "linux_parser.h"
+#include "numa_topology.h"
+
+/**
+ * @brief Samples the memory and the CPU load of every NUMA node.
+ *
+ * Memory in use excludes free memory, the page cache and reclaimable slab,
+ * like the memory utilization of the system. A CPU's load is the share of
+ * its jiffies that were active since the previous sample, so the first
+ * sample shows the load since boot. CPUs that are offline show as idle.
+ *
+ * @param nodes std::vector<NodeRecord>&: Receives one record per node, whose
+ *        vectors keep their capacity.
+ * @return bool: True if the system has NUMA nodes, false otherwise, in which
+ *         case the records are cleared.
+ */
+bool NumaTopology::Sample(std::vector<NodeRecord>& nodes) {
+  if (!listed_) {
+    listed_ = true;
+    if (!LinuxParser::Nodes(nodes_)) {
+      nodes_.clear();
+    }
+    cpus_.resize(nodes_.size());
+    for (std::size_t i = 0; i < nodes_.size(); ++i) {
+      LinuxParser::NodeCpus(nodes_[i], cpus_[i]);
+    }
+  }
+  nodes.resize(nodes_.size());
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  // Index the jiffies by CPU ID, missing CPUs stay zero
+  LinuxParser::ReadCoreJiffies(cores_);
+  current_.assign(current_.size(), LinuxParser::CoreJiffies{});
+  for (LinuxParser::CoreJiffies const& core : cores_) {
+    if (core.cpu < 0) {
+      continue;
+    }
+    if (static_cast<std::size_t>(core.cpu) >= current_.size()) {
+      current_.resize(core.cpu + 1);
+    }
+    current_[core.cpu] = core;
+  }
+  previous_.resize(current_.size());
+
+  for (std::size_t i = 0; i < nodes_.size(); ++i) {
+    NodeRecord& node = nodes[i];
+    node.id = nodes_[i];
+    LinuxParser::NodeMemory memory;
+    if (LinuxParser::ReadNodeMemory(node.id, memory)) {
+      long const used = std::max(0L, memory.total - memory.free -
+                                         memory.file_pages -
+                                         memory.reclaimable);
+      node.memory_total = memory.total / 1024;
+      node.memory_used = used / 1024;
+      node.memory = memory.total > 0
+                        ? static_cast<float>(used) / memory.total
+                        : 0.0f;
+    }
+    node.cpus = cpus_[i];
+    node.cores.resize(node.cpus.size());
+    float sum{0.0};
+    for (std::size_t j = 0; j < node.cpus.size(); ++j) {
+      std::size_t const cpu = node.cpus[j];
+      float load{0.0};
+      if (cpu < current_.size()) {
+        long const total = current_[cpu].total - previous_[cpu].total;
+        long const active = current_[cpu].active - previous_[cpu].active;
+        load = total > 0 ? std::clamp(static_cast<float>(active) / total,
+                                      0.0f, 1.0f)
+                         : 0.0f;
+      }
+      node.cores[j] = static_cast<std::uint8_t>(load * 100 + 0.5f);
+      sum += load;
+    }
+    node.cpu = node.cpus.empty() ? 0.0f : sum / node.cpus.size();
+  }
+  previous_.swap(current_);
+  return true;
+}
@@ -0,0 +1,94 @@
+#include <stdexcept>
+#include <string>
+
+#include "options.h"
+
+/**
+ * @brief Parses the command line arguments into the given options.
+ *
+ * Every option but --batch and --io-uring takes exactly one value. --rule
+ * may be given several times, other options that are not given keep their
+ * default values. --top must be from 1 to kMaxTop.
+ *
+ * @param argc int: The number of arguments, including the program name.
+ * @param argv char*[]: The arguments as passed to main.
+ * @param options Options&: The options to fill in.
+ * @return bool: True if all arguments were understood, false otherwise.
+ */
+bool CommandLine::Parse(int argc, char* argv[], Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string key{argv[i]};
+    if (key == "--batch") {
+      options.batch = true;
+      continue;
+    }
+    if (key == "--io-uring") {
+      options.io_uring = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    std::string value{argv[++i]};
+    try {
+      if (key == "--min-interval") {
+        options.min_interval_ms = std::stol(value);
+      } else if (key == "--max-interval") {
+        options.max_interval_ms = std::stol(value);
+      } else if (key == "--cpu-cap") {
+        options.cpu_cap = std::stof(value) / 100;  // given in percent
+      } else if (key == "--top") {
+        long const top = std::stol(value);
+        if (top < 1 || static_cast<std::size_t>(top) > kMaxTop) {
+          return false;
+        }
+        options.top = top;
+      } else if (key == "--export") {
+        options.export_address = value;
+      } else if (key == "--publish") {
+        options.publish_name = value;
+      } else if (key == "--attach") {
+        options.attach_name = value;
+      } else if (key == "--filter") {
+        options.filter = value;
+      } else if (key == "--sort") {
+        options.sort = value;
+      } else if (key == "--rule") {
+        options.rules.push_back(value);
+      } else if (key == "--alert-hook") {
+        options.alert_hook = value;
+      } else if (key == "--send") {
+        options.send_address = value;
+      } else if (key == "--host") {
+        options.host_name = value;
+      } else if (key == "--collect") {
+        options.collect_address = value;
+      } else {
+        return false;
+      }
+    } catch (std::exception const&) {
+      return false;
+    }
+  }
+  // A monitor either samples /proc itself, attaches to another one or
+  // collects the snapshots of others
+  bool const publishes = !options.export_address.empty() ||
+                         !options.publish_name.empty() ||
+                         !options.send_address.empty();
+  int const sources =
+      !options.attach_name.empty() + !options.collect_address.empty();
+  return options.min_interval_ms > 0 && options.max_interval_ms > 0 &&
+         sources <= 1 && !(publishes && sources > 0);
+}
+
+// Return a short description of the accepted options
+std::string CommandLine::Usage(std::string const& program) {
+  return "Usage: " + program +
+         " [--min-interval MS] [--max-interval MS] [--cpu-cap PERCENT]"
+         " [--export unix:PATH|[HOST:]PORT] [--publish /NAME] [--top K]"
+         " [--attach /NAME] [--filter EXPRESSION]"
+         " [--sort cpu|wait|voluntary|involuntary] [--rule RULE]..."
+         " [--alert-hook COMMAND] [--send unix:PATH|[HOST:]PORT]"
+         " [--host NAME] [--collect unix:PATH|[HOST:]PORT] [--io-uring]"
+         " [--batch]\n";
+}
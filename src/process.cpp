@@ -1,120 +1,64 @@
 #include <unistd.h>
-#include <cctype>
-#include <sstream>
-#include <string>
-#include <vector>
-#include <thread>  // For std::this_thread::sleep_for
-#include <chrono>  // For std::chrono::milliseconds
 
 #include "process.h"
-#include "linux_parser.h"
+#include "process_table.h"
 
-
-using std::to_string;
-using std::vector;
 // constructor
-Process::Process(int pid):pid_{pid} {}
+Process::Process(ProcessTable const& table, std::size_t row)
+    : table_{&table}, row_{row} {}
 
 // Return this process's ID
-int Process::Pid() { return pid_; }
-
-float Process::CpuUtilization() {
-   // Get the current values of active and total jiffies
-    long active_jiffies = LinuxParser::ActiveJiffies(pid_);
-    long total_jiffies = LinuxParser::Jiffies();
-
-    // Calculate the difference between the current and previous values
-    long delta_active_jiffies = active_jiffies - prev_active_jiffies_;
-    long delta_total_jiffies = total_jiffies - prev_total_jiffies_;
-
-    // Avoid division by zero
-    // Define a maximun number of retries and a sleep duration
-    const int max_retries{5};
-    const std::chrono::milliseconds sleep_duration{100};
-    //retry until delta_total_jiffies is not zero or max_retries is reached
-    int retries{0};
-    if (delta_total_jiffies == 0 && retries < max_retries) {
-        // Wait for a short period and re-evaluate the jiffies
-        std::this_thread::sleep_for(sleep_duration);
-        active_jiffies = LinuxParser::ActiveJiffies();
-        total_jiffies = LinuxParser::Jiffies();
-        delta_active_jiffies = active_jiffies - prev_active_jiffies_;
-        delta_total_jiffies = total_jiffies - prev_total_jiffies_;
-        retries++;
-    }
-
-    // Update the previous values with the current values
-    prev_active_jiffies_ = active_jiffies;
-    prev_total_jiffies_ = total_jiffies;
-    
-    // Avoid division by zero
-    if (delta_total_jiffies == 0) {
-        return 0.0;
-    }
-
-    // Calculate the CPU utilization
-    return static_cast<float>(delta_active_jiffies) / delta_total_jiffies;
+int Process::Pid() const { return table_->pid_[row_]; }
+
+// Return this process's share of the CPU time since the previous update
+float Process::CpuUtilization() const { return table_->cpu_[row_]; }
+
+// Copy the recent CPU shares of this process in percent, oldest first
+void Process::CpuHistory(std::vector<std::uint8_t>& samples) const {
+    table_->cpu_history_[row_].CopyTo(samples);
 }
 
-/*
-discard this method because it does not work properly, cpu usage is always 0 or make the reresh rate very slow
+// Return this process's share of the time spent waiting on a run queue
+float Process::Wait() const { return table_->wait_[row_]; }
 
-// Return this process's CPU utilization
-float Process::CpuUtilization() const {
-   // Get the current values of active and total jiffies
-    long initial_active_jiffies_pid = LinuxParser::ActiveJiffies(pid_);
-    long initial_total_jiffies_system = LinuxParser::Jiffies();
+// Return this process's voluntary context switches per second
+float Process::VoluntarySwitches() const {
+    return table_->voluntary_rate_[row_];
+}
 
-    // Wait for a short interval (e.g., 10 milliseconds)
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+// Return this process's involuntary context switches per second
+float Process::InvoluntarySwitches() const {
+    return table_->involuntary_rate_[row_];
+}
 
-    // Measure final CPU time and system jiffies
-    long final_active_jiffies_pid = LinuxParser::ActiveJiffies(pid_);
-    long final_total_jiffies_system = LinuxParser::Jiffies();
+// Return the CPU this process last ran on, or -1 if unknown
+int Process::Processor() const { return table_->processor_[row_]; }
 
-    // Calculate the differences
-    long delta_active_jiffies_pid = final_active_jiffies_pid - initial_active_jiffies_pid;
-    long delta_total_jiffies_system = final_total_jiffies_system - initial_total_jiffies_system;
+// Return how often this process was seen on another CPU than before
+long Process::Migrations() const { return table_->migrations_[row_]; }
 
-    // Calculate CPU usage
-    if (delta_total_jiffies_system > 0) {
-        float cpu_utilization_ = static_cast<float>(delta_active_jiffies_pid) / delta_total_jiffies_system;
-        return cpu_utilization_;
-    }
-    return 0.0;
+// Return whether this process last ran on a CPU it is not allowed on
+bool Process::OutsideAffinity() const {
+    return table_->outside_affinity_[row_];
 }
-*/
-
 
 // Return the command that generated this process
-std::string Process::Command() { 
-    if (cmdline_.empty()) {
-        cmdline_ = LinuxParser::Command(pid_);
-    }
-    return cmdline_; 
+std::string_view Process::Command() const {
+    return table_->strings_.Get(table_->command_[row_]);
 }
 
-// Return this process's memory utilization
-std::string Process::Ram() const{ 
-    return LinuxParser::Ram(pid_); 
-}
+// Return this process's resident memory (in MB)
+long Process::Ram() const { return table_->rss_[row_] / 1024; }
 
 // Return the user (name) that generated this process
-std::string Process::User() {
-    std::string user_ = LinuxParser::User(pid_);
-    return user_;
+std::string_view Process::User() const {
+    return table_->strings_.Get(table_->user_[row_]);
 }
 
 // Return the age of this process (in seconds)
-long int Process::UpTime() {
-     return LinuxParser::UpTime(pid_); 
+long int Process::UpTime() const {
+    return table_->uptime_ - table_->starttime_[row_] / sysconf(_SC_CLK_TCK);
 }
 
-// Overload the "less than" comparison operator for Process objects (not used)
-bool Process::operator<(Process const& a) const {
-    return std::stol(this->Ram()) < std::stol(a.Ram());
-}
-// Overload the "greater than" comparison operator for Process objects to achieve descending order
-bool Process::operator>(Process const& a) const {
-    return std::stol(this->Ram()) > std::stol(a.Ram());
-}
\ No newline at end of file
+// Return the scheduling state of this process
+char Process::State() const { return table_->state_[row_]; }
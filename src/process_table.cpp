@@ -0,0 +1,578 @@
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "linux_parser.h"
+#include "proc_fields.h"
+#include "process_table.h"
+#include "snapshot.h"
+
+namespace Stat = ProcFields::Stat;
+
+// The fields of the stat file every process is ranked and filtered by
+using StatRecord =
+    ProcFields::Record<ProcFields::StatSchema, Stat::kState, Stat::kUtime,
+                       Stat::kStime, Stat::kCutime, Stat::kCstime,
+                       Stat::kStartTime, Stat::kProcessor>;
+
+// The field of the statm file read along with stat by the batch
+using StatmRecord =
+    ProcFields::Record<ProcFields::StatmSchema, ProcFields::Statm::kResident>;
+// The time a process waited on a run queue
+using SchedstatRecord = ProcFields::Record<ProcFields::SchedstatSchema,
+                                           ProcFields::Schedstat::kWaitTime>;
+
+// Return the jiffies a process and its waited-for children were active
+static long ActiveJiffies(StatRecord const& stat) {
+  return stat.Get<Stat::kUtime>() + stat.Get<Stat::kStime>() +
+         stat.Get<Stat::kCutime>() + stat.Get<Stat::kCstime>();
+}
+
+// Move the last entry of a column into the given row and drop the last entry
+template <typename T>
+static void MoveLastInto(std::vector<T>& column, std::size_t row) {
+  column[row] = column.back();
+  column.pop_back();
+}
+
+/**
+ * @brief Compares two sorted sets of process IDs.
+ *
+ * A single merge pass over both arrays finds the IDs only in the current set
+ * (births) and the IDs only in the previous set (exits).
+ *
+ * @param previous std::vector<int>: The sorted IDs of the previous update.
+ * @param current std::vector<int>: The sorted IDs of this update.
+ * @param births std::vector<int>&: Receives the IDs that appeared.
+ * @param exits std::vector<int>&: Receives the IDs that disappeared.
+ */
+static void Diff(std::vector<int> const& previous,
+                 std::vector<int> const& current, std::vector<int>& births,
+                 std::vector<int>& exits) {
+  births.clear();
+  exits.clear();
+  auto old_pid = previous.begin();
+  auto new_pid = current.begin();
+  while (old_pid != previous.end() && new_pid != current.end()) {
+    if (*old_pid < *new_pid) {
+      exits.push_back(*old_pid++);
+    } else if (*new_pid < *old_pid) {
+      births.push_back(*new_pid++);
+    } else {
+      ++old_pid;
+      ++new_pid;
+    }
+  }
+  exits.insert(exits.end(), old_pid, previous.end());
+  births.insert(births.end(), new_pid, current.end());
+}
+
+// Return the change of a counter per nanosecond between two reads, or 0 if
+// there was no previous read
+static float Rate(long value, long previous, long now, long previous_read) {
+  if (previous_read == 0 || now <= previous_read || value < previous) {
+    return 0.0f;
+  }
+  return static_cast<float>(value - previous) / (now - previous_read);
+}
+
+/**
+ * @brief Refreshes the table for the given set of processes.
+ *
+ * The births and exits since the previous update are found by merging the
+ * sorted PIDs against the previous ones: exited processes lose their row and
+ * new ones get a fresh row, as does a process whose PID was reused by a
+ * process with another start time. The stat file is read once for every
+ * process, with all the fields needed from it, since the CPU share is the
+ * difference of the process's active jiffies over the difference of the
+ * system's total jiffies since the previous update. The remaining files are
+ * only read for processes that may still pass the filter, see Admit. With
+ * batch reads, stat, statm and schedstat of all processes are read through
+ * io_uring first, and only the processes missing from the batch are read one
+ * by one.
+ * Every row keeps its recent CPU shares in a fixed-size history.
+ *
+ * @param pids std::vector<int>: The sorted IDs of all current processes.
+ */
+void ProcessTable::Update(std::vector<int> const& pids) {
+  long const total_jiffies = LinuxParser::Jiffies();
+  long const delta_total_jiffies = total_jiffies - prev_total_jiffies_;
+  prev_total_jiffies_ = total_jiffies;
+  uptime_ = LinuxParser::UpTime();
+  now_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+             .count();
+  float const scale =
+      delta_total_jiffies > 0 ? 1.0f / delta_total_jiffies : 0.0f;
+
+  Diff(pids_, pids, births_, exits_);
+  pids_ = pids;
+  for (int pid : exits_) {
+    RemoveRow(rows_[pid]);
+  }
+  for (int pid : births_) {
+    AddRow(pid);
+  }
+
+  // Processes missing from the batch, or all without batch reads, are read
+  // one by one
+  read_.assign(pids.size(), 0);
+  ReadBatch(pids);
+  StatRecord stat;
+  for (std::size_t i = 0; i < pids.size(); ++i) {
+    std::size_t row = rows_[pids[i]];
+    if (!(read_[i] & kStatRead)) {
+      if (!LinuxParser::ReadFields(pids[i], LinuxParser::kStatFilename,
+                                   stat)) {
+        // The process exited after the listing, its row goes with the next one
+        cpu_delta_[row] = 0;
+        visible_[row] = 0;
+        continue;
+      }
+      row = ApplyStat(row, stat.Get<Stat::kStartTime>(), ActiveJiffies(stat),
+                      stat.Get<Stat::kState>(), stat.Get<Stat::kProcessor>());
+    }
+    visible_[row] = Admit(row, cpu_delta_[row] * scale, read_[i]);
+  }
+
+  std::size_t const size = Size();
+  for (std::size_t row = 0; row < size; ++row) {
+    cpu_[row] = cpu_delta_[row] * scale;
+  }
+  for (std::size_t row = 0; row < size; ++row) {
+    cpu_history_[row].Push(cpu_[row]);
+  }
+}
+
+/**
+ * @brief Reads the stat, statm and schedstat files of all processes as one
+ *        batch.
+ *
+ * The files are parsed as their reads complete. Nothing is read unless batch
+ * reads are in use, and if the ring fails the table reads synchronously from
+ * then on.
+ *
+ * @param pids std::vector<int>: The sorted IDs of all current processes.
+ */
+void ProcessTable::ReadBatch(std::vector<int> const& pids) {
+  if (!reader_.Start(pids)) {
+    return;
+  }
+  StatRecord stat;
+  StatmRecord statm;
+  SchedstatRecord schedstat;
+  long const page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  BatchReader::Completion done;
+  while (reader_.Next(done)) {
+    std::size_t const row = rows_[pids[done.index]];
+    if (done.file == 0 && stat.Parse(done.text)) {
+      ApplyStat(row, stat.Get<Stat::kStartTime>(), ActiveJiffies(stat),
+                stat.Get<Stat::kState>(), stat.Get<Stat::kProcessor>());
+      read_[done.index] |= kStatRead;
+    } else if (done.file == 1 && (read_[done.index] & kStatRead) &&
+               statm.Parse(done.text)) {
+      rss_[row] = statm.Get<ProcFields::Statm::kResident>() * page_kb;
+      read_[done.index] |= kStatmRead;
+    } else if (done.file == 2 && (read_[done.index] & kStatRead) &&
+               schedstat.Parse(done.text)) {
+      ApplyWait(row, schedstat.Get<ProcFields::Schedstat::kWaitTime>());
+      read_[done.index] |= kSchedstatRead;
+    }
+  }
+}
+
+/**
+ * @brief Applies the stat fields of a process to its row.
+ *
+ * A process whose PID was reused by a process with another start time gets
+ * a fresh row. A migration is counted whenever the CPU the process last ran
+ * on differs from the one of the previous update, so moves back and forth
+ * between two updates go unnoticed and the count is a lower bound.
+ *
+ * @param row std::size_t: The row of the process.
+ * @param starttime long: The start time in jiffies after boot.
+ * @param active_jiffies long: The jiffies the process was active.
+ * @param state char: The state of the process.
+ * @param processor int: The CPU the process last ran on.
+ * @return std::size_t: The row of the process, which changes with a new row.
+ */
+std::size_t ProcessTable::ApplyStat(std::size_t row, long starttime,
+                                    long active_jiffies, char state,
+                                    int processor) {
+  if (starttime_[row] != starttime) {
+    if (starttime_[row] != kNoStartTime) {
+      // The PID was reused, the row starts over
+      int const pid = pid_[row];
+      RemoveRow(row);
+      row = AddRow(pid);
+    }
+    starttime_[row] = starttime;
+  }
+  cpu_delta_[row] = std::max(0L, active_jiffies - active_jiffies_[row]);
+  active_jiffies_[row] = active_jiffies;
+  state_[row] = state;
+  if (processor_[row] >= 0 && processor != processor_[row]) {
+    ++migrations_[row];
+  }
+  processor_[row] = processor;
+  return row;
+}
+
+/**
+ * @brief Reads the files of the processes through io_uring from now on.
+ *
+ * @return bool: True if the kernel supports it, false if the table keeps
+ *         reading synchronously.
+ */
+bool ProcessTable::UseBatchReads() {
+  return reader_.Open({LinuxParser::kStatFilename, LinuxParser::kStatmFilename,
+                       LinuxParser::kSchedstatFilename});
+}
+
+/**
+ * @brief Applies the fields of a status file to a row.
+ *
+ * The context switch rates are per second since the status file of the row
+ * was last read, which is not necessarily the previous update if the filter
+ * rejected the process before its status stage. The CPU the process last ran
+ * on, from the stat file of the same update, is checked against the CPUs it
+ * is allowed on, so a pinned process that strays is flagged.
+ *
+ * @param row std::size_t: The row of the process.
+ * @param status LinuxParser::ProcessStatus: The fields read from the file.
+ */
+void ProcessTable::ApplyStatus(std::size_t row,
+                               LinuxParser::ProcessStatus const& status) {
+  voluntary_rate_[row] = 1e9f * Rate(status.voluntary_switches,
+                                     voluntary_switches_[row], now_,
+                                     status_read_[row]);
+  involuntary_rate_[row] = 1e9f * Rate(status.involuntary_switches,
+                                       involuntary_switches_[row], now_,
+                                       status_read_[row]);
+  voluntary_switches_[row] = status.voluntary_switches;
+  involuntary_switches_[row] = status.involuntary_switches;
+  status_read_[row] = now_;
+  outside_affinity_[row] =
+      processor_[row] >= 0 && !status.cpus_allowed.empty() &&
+      !LinuxParser::ListContains(status.cpus_allowed, processor_[row]);
+}
+
+// Apply the run queue wait time of a process, in nanoseconds, to its row
+void ProcessTable::ApplyWait(std::size_t row, long wait_time) {
+  wait_[row] = Rate(wait_time, wait_time_[row], now_, wait_read_[row]);
+  wait_time_[row] = wait_time;
+  wait_read_[row] = now_;
+}
+
+/**
+ * @brief Compiles the filter deciding which processes are visible.
+ *
+ * The new filter takes effect with the next update.
+ *
+ * @param expression std::string: The filter expression, empty to show all.
+ * @param error std::string&: Receives the reason if the expression is invalid.
+ * @return bool: True if the filter was changed, false otherwise.
+ */
+bool ProcessTable::SetFilter(std::string const& expression,
+                             std::string& error) {
+  return filter_.Compile(expression, error);
+}
+
+// Return the expression of the current filter
+std::string const& ProcessTable::FilterExpression() const {
+  return filter_.Expression();
+}
+
+/**
+ * @brief Selects the column the rows are ranked by.
+ *
+ * @param column std::string: One of kSortColumns.
+ * @param error std::string&: Receives the reason if the column is unknown.
+ * @return bool: True if the column was changed, false otherwise.
+ */
+bool ProcessTable::SetSort(std::string const& column, std::string& error) {
+  for (std::size_t i = 0; i < std::size(kSortColumns); ++i) {
+    if (column == kSortColumns[i]) {
+      sort_ = static_cast<SortKey>(i);
+      return true;
+    }
+  }
+  error = "unknown column '" + column + "'";
+  return false;
+}
+
+// Return the name of the column the rows are ranked by
+std::string ProcessTable::SortColumn() const { return kSortColumns[sort_]; }
+
+// Return the number of rows
+std::size_t ProcessTable::Size() const { return pid_.size(); }
+
+// Return true if the process has a row, whether or not it is visible
+bool ProcessTable::Contains(int pid) const { return rows_.count(pid) > 0; }
+
+// Return a view of the given row
+Process ProcessTable::operator[](std::size_t row) const {
+  return Process(*this, row);
+}
+
+/**
+ * @brief Ranks the rows by the sort column, CPU utilization by default.
+ *
+ * Only visible rows are ranked. The k-th largest value is selected from a
+ * copy of the sort column first, in which hidden rows are pushed to the bottom;
+ * a single pass over the column then collects the rows at or above it, and
+ * only those few rows are sorted. Ties are broken by the lower PID.
+ *
+ * @param k std::size_t: The maximum number of rows to return.
+ * @param rows std::vector<std::uint32_t>&: Receives the ranked row indices.
+ */
+void ProcessTable::TopK(std::size_t k,
+                        std::vector<std::uint32_t>& rows) const {
+  rows.clear();
+  std::vector<float> const& key =
+      sort_ == kSortWait          ? wait_
+      : sort_ == kSortVoluntary   ? voluntary_rate_
+      : sort_ == kSortInvoluntary ? involuntary_rate_
+                                  : cpu_;
+  std::size_t const size = Size();
+  if (k == 0 || size == 0) {
+    return;
+  }
+  float const hidden = std::numeric_limits<float>::lowest();
+  float threshold = hidden;
+  if (k < size) {
+    scratch_.resize(size);
+    for (std::size_t row = 0; row < size; ++row) {
+      scratch_[row] = visible_[row] ? key[row] : hidden;
+    }
+    std::nth_element(scratch_.begin(), scratch_.begin() + (k - 1),
+                     scratch_.end(), std::greater<float>());
+    threshold = scratch_[k - 1];
+  }
+  for (std::size_t row = 0; row < size; ++row) {
+    if (visible_[row] && key[row] >= threshold) {
+      rows.push_back(row);
+    }
+  }
+  std::sort(rows.begin(), rows.end(),
+            [this, &key](std::uint32_t a, std::uint32_t b) {
+              return key[a] != key[b] ? key[a] > key[b] : pid_[a] < pid_[b];
+            });
+  if (rows.size() > k) {
+    rows.resize(k);
+  }
+}
+
+// Return the resident memory of all visible processes (in KB)
+long ProcessTable::TotalRss() const {
+  long total{0};
+  std::size_t const size = Size();
+  for (std::size_t row = 0; row < size; ++row) {
+    total += visible_[row] ? rss_[row] : 0;
+  }
+  return total;
+}
+
+/**
+ * @brief Counts the visible processes that were active on each CPU.
+ *
+ * A process counts for the CPU it last ran on if it used any CPU time since
+ * the previous update, so the counts show where the active processes sit.
+ * Every process passing the filter counts, not only the top ones shown.
+ *
+ * @param cpus std::vector<std::uint8_t>&: Receives the counts indexed by CPU
+ *        ID, saturating at 255.
+ */
+void ProcessTable::Occupancy(std::vector<std::uint8_t>& cpus) const {
+  cpus.clear();
+  std::size_t const size = Size();
+  for (std::size_t row = 0; row < size; ++row) {
+    if (!visible_[row] || cpu_delta_[row] == 0 || processor_[row] < 0) {
+      continue;
+    }
+    std::size_t const cpu = processor_[row];
+    if (cpu >= cpus.size()) {
+      cpus.resize(cpu + 1, 0);
+    }
+    cpus[cpu] += cpus[cpu] < 255;
+  }
+}
+
+// Return the memory used by the interned command lines and user names
+StringPool::Usage ProcessTable::StringUsage() const {
+  return strings_.MemoryUsage();
+}
+
+/**
+ * @brief Reads the remaining fields of a process as far as the filter needs.
+ *
+ * The stages are read in the order of their cost: statm for the memory,
+ * status for the UID (and the user name if the UID changed), the context
+ * switches and the allowed CPUs, and cmdline unless the command line is
+ * already known. While the filter is undecided only the stages it compares
+ * fields of are read, and it is evaluated after each of them, so a process
+ * it rejects is not read any further. A process that passes the filter is
+ * read completely, since all of its fields are shown, including its run
+ * queue wait time.
+ *
+ * @param row std::size_t: The row of the process, its stat fields are read.
+ * @param cpu float: The CPU share of the process since the previous update.
+ * @param read char: The files read along with stat, see kStatmRead.
+ * @return bool: True if the process passes the filter, false otherwise.
+ */
+bool ProcessTable::Admit(std::size_t row, float cpu, char read) {
+  int const pid = pid_[row];
+  Filter::Fields fields;
+  fields.pid = pid;
+  fields.cpu = cpu * 100;
+  fields.state = state_[row];
+  fields.uptime = uptime_ - starttime_[row] / sysconf(_SC_CLK_TCK);
+  Filter::Result result = filter_.Evaluate(fields, Filter::kStat);
+
+  Filter::Stage const stages[]{Filter::kStatm, Filter::kStatus,
+                               Filter::kCmdline};
+  bool done[std::size(stages)]{};
+  for (std::size_t i = 0; i < std::size(stages); ++i) {
+    if (result == Filter::kUnknown && filter_.Needs(stages[i])) {
+      ReadStage(row, stages[i], read, fields);
+      done[i] = true;
+      result = filter_.Evaluate(fields, stages[i]);
+    }
+  }
+  if (result != Filter::kTrue) {
+    return false;
+  }
+  for (std::size_t i = 0; i < std::size(stages); ++i) {
+    if (!done[i]) {
+      ReadStage(row, stages[i], read, fields);
+    }
+  }
+
+  SchedstatRecord schedstat;
+  if (!(read & kSchedstatRead) &&
+      LinuxParser::ReadFields(pid, LinuxParser::kSchedstatFilename,
+                              schedstat)) {
+    ApplyWait(row, schedstat.Get<ProcFields::Schedstat::kWaitTime>());
+  }
+  return true;
+}
+
+// Read the files of one stage of the filter and fill in its fields
+void ProcessTable::ReadStage(std::size_t row, Filter::Stage stage, char read,
+                             Filter::Fields& fields) {
+  int const pid = pid_[row];
+  switch (stage) {
+    case Filter::kStat:
+      break;
+    case Filter::kStatm:
+      if (!(read & kStatmRead)) {
+        rss_[row] = LinuxParser::Rss(pid);
+      }
+      fields.ram = rss_[row] / 1024;
+      break;
+    case Filter::kStatus: {
+      LinuxParser::ProcessStatus status;
+      if (LinuxParser::ReadStatus(pid, status)) {
+        ApplyStatus(row, status);
+      }
+      int const uid = status.uid;
+      if (uid != uid_[row] || user_[row] == kNoString) {
+        uid_[row] = uid;
+        Release(user_[row]);
+        user_[row] = strings_.Intern(LinuxParser::UserName(uid));
+      }
+      fields.uid = uid;
+      fields.user = strings_.Get(user_[row]);
+      break;
+    }
+    case Filter::kCmdline:
+      if (command_[row] == kNoString) {
+        command_[row] = strings_.Intern(LinuxParser::Command(pid));
+      }
+      fields.command = strings_.Get(command_[row]);
+      break;
+  }
+}
+
+// Release a string of the pool unless it was never read
+void ProcessTable::Release(std::uint32_t id) {
+  if (id != kNoString) {
+    strings_.Release(id);
+  }
+}
+
+/**
+ * @brief Appends a row for a new process.
+ *
+ * The per-tick columns are zeroed and filled in by the caller. Command line
+ * and user are only read once the process passes the stages of the filter
+ * before them, and then kept for the lifetime of the row.
+ *
+ * @param pid int: The ID of the new process.
+ * @return std::size_t: The index of the new row.
+ */
+std::size_t ProcessTable::AddRow(int pid) {
+  std::size_t const row = Size();
+  pid_.push_back(pid);
+  starttime_.push_back(kNoStartTime);
+  active_jiffies_.push_back(0);
+  cpu_delta_.push_back(0);
+  cpu_.push_back(0.0);
+  cpu_history_.emplace_back();
+  wait_time_.push_back(0);
+  wait_.push_back(0.0);
+  wait_read_.push_back(kNotRead);
+  voluntary_switches_.push_back(0);
+  involuntary_switches_.push_back(0);
+  voluntary_rate_.push_back(0.0);
+  involuntary_rate_.push_back(0.0);
+  status_read_.push_back(kNotRead);
+  processor_.push_back(-1);
+  migrations_.push_back(0);
+  outside_affinity_.push_back(0);
+  rss_.push_back(0);
+  state_.push_back('?');
+  uid_.push_back(-1);
+  command_.push_back(kNoString);
+  user_.push_back(kNoString);
+  visible_.push_back(0);
+  rows_[pid] = row;
+  return row;
+}
+
+// Remove a row by moving the last row into its place
+void ProcessTable::RemoveRow(std::size_t row) {
+  Release(command_[row]);
+  Release(user_[row]);
+  rows_.erase(pid_[row]);
+  if (row + 1 != Size()) {
+    rows_[pid_.back()] = row;
+  }
+  MoveLastInto(pid_, row);
+  MoveLastInto(starttime_, row);
+  MoveLastInto(active_jiffies_, row);
+  MoveLastInto(cpu_delta_, row);
+  MoveLastInto(cpu_, row);
+  MoveLastInto(cpu_history_, row);
+  MoveLastInto(wait_time_, row);
+  MoveLastInto(wait_, row);
+  MoveLastInto(wait_read_, row);
+  MoveLastInto(voluntary_switches_, row);
+  MoveLastInto(involuntary_switches_, row);
+  MoveLastInto(voluntary_rate_, row);
+  MoveLastInto(involuntary_rate_, row);
+  MoveLastInto(status_read_, row);
+  MoveLastInto(processor_, row);
+  MoveLastInto(migrations_, row);
+  MoveLastInto(outside_affinity_, row);
+  MoveLastInto(rss_, row);
+  MoveLastInto(state_, row);
+  MoveLastInto(uid_, row);
+  MoveLastInto(command_, row);
+  MoveLastInto(user_, row);
+  MoveLastInto(visible_, row);
+}
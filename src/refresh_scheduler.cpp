@@ -0,0 +1,132 @@
+#include <sys/resource.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>  // For std::this_thread::sleep_until
+
+#include "refresh_scheduler.h"
+
+// A metric moving by more than 5 percentage points per tick is changing fast
+const float kFastChange{0.05};
+// A metric moving by less than 1 percentage point per tick is stable
+const float kStableChange{0.01};
+const float kGrowFactor{1.25};
+const float kShrinkFactor{0.5};
+
+/**
+ * @brief Constructs a scheduler with the given interval bounds and CPU cap.
+ *
+ * The scheduler starts at a one second interval, clamped into the given bounds.
+ * If the bounds are given in the wrong order they are swapped.
+ *
+ * @param min_interval Milliseconds: The shortest interval between two ticks.
+ * @param max_interval Milliseconds: The longest interval between two ticks.
+ * @param cpu_cap float: The maximum fraction of one CPU the monitor may use.
+ */
+RefreshScheduler::RefreshScheduler(Milliseconds min_interval,
+                                   Milliseconds max_interval, float cpu_cap)
+    : min_interval_{std::min(min_interval, max_interval)},
+      max_interval_{std::max(min_interval, max_interval)},
+      cpu_cap_{cpu_cap},
+      interval_{std::clamp(Milliseconds{1000}, min_interval_, max_interval_)},
+      deadline_{Clock::now()} {}
+
+// Start collecting the metrics of a new tick
+void RefreshScheduler::BeginTick() { values_.clear(); }
+
+// Record one metric (as a fraction from 0.0 to 1.0) of the current tick
+void RefreshScheduler::Observe(float value) { values_.push_back(value); }
+
+/**
+ * @brief Finishes the current tick and schedules the next one.
+ *
+ * This function compares the metrics observed during this tick with the ones of
+ * the previous tick. The interval is halved when any metric changed quickly and
+ * grown when all of them were stable. Independently, when the monitor's own CPU
+ * share since the previous tick exceeds the cap, the interval is stretched in
+ * proportion so that the share falls back under the cap. The next deadline is
+ * chained from the previous deadline, so the time spent sampling is compensated
+ * and ticks don't drift. A deadline that has already passed is moved to now
+ * instead of firing a burst of catch-up ticks.
+ *
+ * @return Milliseconds: The time left until the next tick.
+ */
+RefreshScheduler::Milliseconds RefreshScheduler::EndTick() {
+  Clock::time_point now = Clock::now();
+  double cpu_seconds = SelfCpuSeconds();
+  // The self cost is measured over whole periods, the first one starts now
+  double wall_seconds =
+      std::chrono::duration<double>(now - prev_wall_).count();
+  if (prev_wall_ != Clock::time_point{} && wall_seconds > 0) {
+    self_cpu_share_ = (cpu_seconds - prev_cpu_seconds_) / wall_seconds;
+  }
+  prev_wall_ = now;
+  prev_cpu_seconds_ = cpu_seconds;
+
+  // The first tick (or a change of the observed metrics) has nothing to compare
+  if (values_.size() == prev_values_.size() && !values_.empty()) {
+    float change{0.0};
+    for (std::size_t i = 0; i < values_.size(); ++i) {
+      change = std::max(change, std::fabs(values_[i] - prev_values_[i]));
+    }
+    if (change >= kFastChange) {
+      interval_ = Milliseconds{
+          static_cast<long>(interval_.count() * kShrinkFactor)};
+    } else if (change <= kStableChange) {
+      // Rounded up, so a short interval still grows by at least 1 ms
+      interval_ = Milliseconds{std::max(
+          interval_.count() + 1,
+          static_cast<long>(std::ceil(interval_.count() * kGrowFactor)))};
+    }
+  }
+  if (cpu_cap_ > 0 && self_cpu_share_ > cpu_cap_) {
+    interval_ = Milliseconds{static_cast<long>(
+        std::ceil(interval_.count() * self_cpu_share_ / cpu_cap_))};
+  }
+  interval_ = std::clamp(interval_, min_interval_, max_interval_);
+  prev_values_.swap(values_);
+
+  deadline_ += interval_;
+  if (deadline_ < now) {
+    deadline_ = now;
+  }
+  return Remaining();
+}
+
+// Return the time left until the next tick
+RefreshScheduler::Milliseconds RefreshScheduler::Remaining() const {
+  Clock::time_point now = Clock::now();
+  if (deadline_ <= now) {
+    return Milliseconds{0};
+  }
+  return std::chrono::duration_cast<Milliseconds>(deadline_ - now);
+}
+
+// Block until the next tick is due
+void RefreshScheduler::SleepUntilNextTick() const {
+  std::this_thread::sleep_until(deadline_);
+}
+
+// Return the current interval between two ticks
+RefreshScheduler::Milliseconds RefreshScheduler::Interval() const {
+  return interval_;
+}
+
+// Return the fraction of one CPU the monitor used during the last tick
+float RefreshScheduler::SelfCpuShare() const { return self_cpu_share_; }
+
+/**
+ * @brief Retrieves the CPU time consumed by the monitor itself.
+ *
+ * This function sums the user and system time of all threads of the calling
+ * process as reported by getrusage.
+ *
+ * @return double: The consumed CPU time in seconds, or 0 if it cannot be read.
+ */
+double RefreshScheduler::SelfCpuSeconds() const {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cmath>
+
+#include "rolling_stats.h"
+
+/**
+ * @brief Adds a sample to the average.
+ *
+ * The weight of the new sample depends on the time since the previous one, so
+ * irregular sampling intervals don't change how fast old samples fade out.
+ * The first sample becomes the average.
+ *
+ * @param value double: The new sample.
+ * @param elapsed_seconds double: The time since the previous sample.
+ */
+void Ewma::Add(double value, double elapsed_seconds) {
+  if (empty_) {
+    value_ = value;
+    empty_ = false;
+    return;
+  }
+  double const alpha = 1.0 - std::exp(-elapsed_seconds / time_constant_);
+  value_ += alpha * (value - value_);
+}
+
+// Constructor for the given quantile, from 0.0 to 1.0
+P2Quantile::P2Quantile(double quantile)
+    : quantile_{std::clamp(quantile, 0.0, 1.0)},
+      desired_{1, 1 + 2 * quantile_, 1 + 4 * quantile_, 3 + 2 * quantile_, 5},
+      increments_{0, quantile_ / 2, quantile_, (1 + quantile_) / 2, 1} {}
+
+/**
+ * @brief Adds a sample to the estimate.
+ *
+ * The first five samples are kept as they are. From then on five markers
+ * track the minimum, the maximum, the quantile and the two points halfway to
+ * it; each sample moves the markers' positions, and markers that drifted from
+ * their desired position are adjusted with a parabolic (or, if that breaks
+ * their order, linear) prediction of their height.
+ *
+ * @param value double: The new sample.
+ */
+void P2Quantile::Add(double value) {
+  if (count_ < 5) {
+    heights_[count_++] = value;
+    if (count_ == 5) {
+      std::sort(heights_.begin(), heights_.end());
+      positions_ = {1, 2, 3, 4, 5};
+    }
+    return;
+  }
+  ++count_;
+
+  int cell;
+  if (value < heights_[0]) {
+    heights_[0] = value;
+    cell = 0;
+  } else if (value >= heights_[4]) {
+    heights_[4] = value;
+    cell = 3;
+  } else {
+    cell = 0;
+    while (value >= heights_[cell + 1]) {
+      ++cell;
+    }
+  }
+  for (int i = cell + 1; i < 5; ++i) {
+    positions_[i] += 1;
+  }
+  for (int i = 0; i < 5; ++i) {
+    desired_[i] += increments_[i];
+  }
+
+  for (int i = 1; i < 4; ++i) {
+    double const drift = desired_[i] - positions_[i];
+    if ((drift >= 1 && positions_[i + 1] - positions_[i] > 1) ||
+        (drift <= -1 && positions_[i - 1] - positions_[i] < -1)) {
+      int const direction = drift >= 0 ? 1 : -1;
+      double height = Parabolic(i, direction);
+      if (height <= heights_[i - 1] || height >= heights_[i + 1]) {
+        height = Linear(i, direction);
+      }
+      heights_[i] = height;
+      positions_[i] += direction;
+    }
+  }
+}
+
+/**
+ * @brief Returns the current estimate of the quantile.
+ *
+ * Until five samples were added the estimate is taken from the sorted samples.
+ *
+ * @return double: The estimate, or 0 if no sample was added.
+ */
+double P2Quantile::Value() const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  if (count_ < 5) {
+    std::array<double, 5> sorted = heights_;
+    std::sort(sorted.begin(), sorted.begin() + count_);
+    return sorted[static_cast<std::size_t>(quantile_ * (count_ - 1) + 0.5)];
+  }
+  return heights_[2];
+}
+
+// Predict the height of marker i moved by one position with a parabola
+double P2Quantile::Parabolic(int i, int direction) const {
+  double const d = direction;
+  double const below = positions_[i] - positions_[i - 1];
+  double const above = positions_[i + 1] - positions_[i];
+  return heights_[i] +
+         d / (positions_[i + 1] - positions_[i - 1]) *
+             ((below + d) * (heights_[i + 1] - heights_[i]) / above +
+              (above - d) * (heights_[i] - heights_[i - 1]) / below);
+}
+
+// Predict the height of marker i moved by one position towards a neighbour
+double P2Quantile::Linear(int i, int direction) const {
+  return heights_[i] + direction * (heights_[i + direction] - heights_[i]) /
+                           (positions_[i + direction] - positions_[i]);
+}
@@ -0,0 +1,481 @@
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rule_engine.h"
+
+extern char** environ;
+
+// Split a rule into words, with '<' and '>' as words of their own
+static std::vector<std::string> Words(std::string const& text) {
+  std::vector<std::string> words;
+  std::string word;
+  for (char c : text) {
+    if (std::isspace(static_cast<unsigned char>(c)) || c == '<' || c == '>') {
+      if (!word.empty()) {
+        words.push_back(word);
+        word.clear();
+      }
+      if (c == '<' || c == '>') {
+        words.emplace_back(1, c);
+      }
+    } else {
+      word += c;
+    }
+  }
+  if (!word.empty()) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+// Parse a number, optionally followed by '%', into value
+static bool Number(std::string word, double& value) {
+  if (!word.empty() && word.back() == '%') {
+    word.pop_back();
+  }
+  char* end;
+  value = std::strtod(word.c_str(), &end);
+  return !word.empty() && *end == '\0';
+}
+
+// Parse a duration such as 30, 30s, 5m, 5min or 1h into seconds
+static bool Duration(std::string const& word, double& seconds) {
+  char* end;
+  seconds = std::strtod(word.c_str(), &end);
+  std::string const unit{end};
+  if (word.empty() || end == word.c_str() || seconds < 0) {
+    return false;
+  }
+  if (unit == "m" || unit == "min") {
+    seconds *= 60;
+  } else if (unit == "h") {
+    seconds *= 3600;
+  } else if (!unit.empty() && unit != "s") {
+    return false;
+  }
+  return true;
+}
+
+// Name a process by its PID and the program of its command line
+static std::string ProcessName(ProcessRecord const& process) {
+  std::string program = process.command.substr(0, process.command.find(' '));
+  program = program.substr(program.rfind('/') + 1);
+  return (process.host.empty() ? "" : "[" + process.host + "] ") + "pid " +
+         std::to_string(process.pid) +
+         (program.empty() ? "" : " (" + program + ")");
+}
+
+// Constructor wrapping a source, alerts are passed to hook if not empty
+RuleEngine::RuleEngine(SnapshotSource& source, std::string hook)
+    : source_{source}, hook_{std::move(hook)} {}
+
+RuleEngine::Track::Track(Rule const& rule)
+    : average{kAverageSeconds}, quantile{rule.quantile} {}
+
+/**
+ * @brief Compiles a rule and adds it to the engine.
+ *
+ * A rule reads
+ *   (system|process) METRIC [avg|pNN] (> N|< N|rising|falling) [for TIME]
+ *   [clear N]
+ * where the metrics are cpu and memory of the system in percent, and cpu in
+ * percent and ram in MB of a process. avg is a moving average over about
+ * half a minute and pNN the NN-th percentile over the subject's lifetime.
+ * rising and falling compare the slope over the last samples with zero. The
+ * clear level defaults to 10% below (or above) the threshold.
+ *
+ * @param text std::string: The rule.
+ * @param error std::string&: Receives the reason if the rule is invalid.
+ * @return bool: True if the rule was added, false otherwise.
+ */
+bool RuleEngine::AddRule(std::string const& text, std::string& error) {
+  std::vector<std::string> const words = Words(text);
+  std::size_t next{0};
+  auto word = [&]() { return next < words.size() ? words[next] : ""; };
+  Rule rule{};
+  rule.text = text;
+
+  if (word() == "system" || word() == "process") {
+    rule.process = word() == "process";
+  } else {
+    error = "a rule starts with system or process";
+    return false;
+  }
+  ++next;
+  if (word() == "cpu") {
+    rule.metric = Rule::kCpu;
+  } else if (word() == "memory" && !rule.process) {
+    rule.metric = Rule::kMemory;
+  } else if (word() == "ram" && rule.process) {
+    rule.metric = Rule::kRam;
+  } else {
+    error = "unknown metric '" + word() + "', expected " +
+            (rule.process ? "cpu or ram" : "cpu or memory");
+    return false;
+  }
+  ++next;
+  if (word() == "avg") {
+    rule.statistic = Rule::kAverage;
+    ++next;
+  } else if (word().size() > 1 && word()[0] == 'p') {
+    double percentile;
+    if (!Number(word().substr(1), percentile) || percentile <= 0 ||
+        percentile >= 100) {
+      error = "'" + word() + "' is no percentile, e.g. p95";
+      return false;
+    }
+    rule.statistic = Rule::kQuantile;
+    rule.quantile = percentile / 100;
+    ++next;
+  }
+
+  if (word() == ">" || word() == "<") {
+    rule.condition = word() == ">" ? Rule::kAbove : Rule::kBelow;
+    ++next;
+    if (!Number(word(), rule.threshold)) {
+      error = "expected a threshold instead of '" + word() + "'";
+      return false;
+    }
+    double const band = 0.1 * std::abs(rule.threshold);
+    rule.clear = rule.condition == Rule::kAbove ? rule.threshold - band
+                                                : rule.threshold + band;
+  } else if (word() == "rising" || word() == "falling") {
+    rule.condition = word() == "rising" ? Rule::kRising : Rule::kFalling;
+  } else {
+    error = "expected >, <, rising or falling instead of '" + word() + "'";
+    return false;
+  }
+  ++next;
+
+  if (word() == "for") {
+    ++next;
+    std::string duration = word();
+    ++next;
+    // "for 5 min" reads as well as "for 5min"
+    if (word() == "s" || word() == "m" || word() == "min" || word() == "h") {
+      duration += word();
+      ++next;
+    }
+    if (!Duration(duration, rule.seconds)) {
+      error = "'" + duration + "' is no duration, e.g. 30s or 5m";
+      return false;
+    }
+  }
+  if (word() == "clear") {
+    ++next;
+    if (rule.condition == Rule::kRising || rule.condition == Rule::kFalling ||
+        !Number(word(), rule.clear)) {
+      error = "clear takes the level a threshold alert resolves at";
+      return false;
+    }
+    ++next;
+  }
+  if (next < words.size()) {
+    error = "unexpected '" + word() + "'";
+    return false;
+  }
+  rules_.push_back(rule);
+  // The state of every subject starts over with the new set of rules
+  system_.tracks.clear();
+  processes_.clear();
+  return true;
+}
+
+/**
+ * @brief Samples the wrapped source and evaluates the rules on the snapshot.
+ *
+ * The system and every process are tracked separately. With process rules
+ * the source is sampled with all of its visible processes, so a process is
+ * judged whether or not it ranks among the top k, and the snapshot is cut to
+ * the top k afterwards. A process is recognized by its PID and start time;
+ * its state is only dropped, and its firing alerts resolved, once the source
+ * no longer runs it, and is kept while the filter hides it.
+ *
+ * @param snapshot Snapshot&: Receives the snapshot and its alerts.
+ * @param k std::size_t: The number of top processes to sample.
+ * @return bool: True if the source had a new snapshot, false otherwise.
+ */
+bool RuleEngine::Sample(Snapshot& snapshot, std::size_t k) {
+  ReapHooks();
+  bool const process_rules =
+      std::any_of(rules_.begin(), rules_.end(),
+                  [](Rule const& rule) { return rule.process; });
+  if (!process_rules) {
+    if (!source_.Sample(snapshot, k)) {
+      return false;
+    }
+  } else {
+    // Sample into a scratch snapshot, its records keep their buffers
+    if (!source_.Sample(sample_, std::numeric_limits<std::size_t>::max())) {
+      return false;
+    }
+    snapshot.system = sample_.system;
+    snapshot.hosts = sample_.hosts;
+    snapshot.nodes = sample_.nodes;
+    snapshot.processes.assign(
+        sample_.processes.begin(),
+        sample_.processes.begin() + std::min(k, sample_.processes.size()));
+  }
+  Clock::time_point const now = Clock::now();
+  double const elapsed =
+      last_ == Clock::time_point{}
+          ? 0.0
+          : std::chrono::duration<double>(now - last_).count();
+  last_ = now;
+  std::vector<AlertRecord>& alerts = snapshot.alerts;
+  alerts.clear();
+  if (rules_.empty()) {
+    return true;
+  }
+
+  if (system_.tracks.empty()) {
+    system_.tracks = Tracks();
+  }
+  for (std::size_t i = 0; i < rules_.size(); ++i) {
+    if (!rules_[i].process) {
+      double const value = rules_[i].metric == Rule::kCpu
+                               ? snapshot.system.cpu * 100
+                               : snapshot.system.memory * 100;
+      Evaluate(rules_[i], system_.tracks[i], value, "system", now, elapsed,
+               alerts);
+    }
+  }
+
+  if (process_rules) {
+    for (auto& host : processes_) {
+      for (auto& entry : host.second) {
+        entry.second.seen = false;
+      }
+    }
+    for (ProcessRecord const& process : sample_.processes) {
+      long const started = snapshot.system.uptime - process.uptime;
+      Subject& subject = processes_[process.host][process.pid];
+      std::string const name = ProcessName(process);
+      // Start times are rounded to seconds, allow for one of jitter
+      if (subject.tracks.empty() || std::abs(subject.started - started) > 1) {
+        Resolve(subject, name, alerts);
+        subject.tracks = Tracks();
+        subject.started = started;
+      }
+      subject.seen = true;
+      for (std::size_t i = 0; i < rules_.size(); ++i) {
+        if (rules_[i].process) {
+          double const value = rules_[i].metric == Rule::kCpu
+                                   ? process.cpu * 100
+                                   : static_cast<double>(process.ram);
+          Evaluate(rules_[i], subject.tracks[i], value, name, now, elapsed,
+                   alerts);
+        }
+      }
+    }
+    for (auto host = processes_.begin(); host != processes_.end();) {
+      std::string const prefix =
+          host->first.empty() ? "" : "[" + host->first + "] ";
+      auto& subjects = host->second;
+      for (auto entry = subjects.begin(); entry != subjects.end();) {
+        // Only the local system can tell whether an unseen process still runs
+        if (!entry->second.seen &&
+            (!host->first.empty() || !source_.Running(entry->first))) {
+          Resolve(entry->second, prefix + "pid " + std::to_string(entry->first),
+                  alerts);
+          entry = subjects.erase(entry);
+        } else {
+          ++entry;
+        }
+      }
+      host = subjects.empty() ? processes_.erase(host) : std::next(host);
+    }
+  }
+
+  for (AlertRecord const& alert : alerts) {
+    RunHook(alert);
+  }
+  return true;
+}
+
+// Filter the processes of the wrapped source
+bool RuleEngine::SetFilter(std::string const& expression, std::string& error) {
+  return source_.SetFilter(expression, error);
+}
+
+// Rank the processes of the wrapped source
+bool RuleEngine::SetSort(std::string const& column, std::string& error) {
+  return source_.SetSort(column, error);
+}
+
+// Read the memory per NUMA node of a process of the wrapped source
+bool RuleEngine::NumaPages(int pid, std::vector<long>& kilobytes,
+                           std::string& error) {
+  return source_.NumaPages(pid, kilobytes, error);
+}
+
+// Ask the wrapped source
+bool RuleEngine::Running(int pid) const { return source_.Running(pid); }
+
+/**
+ * @brief Adds a sample to the statistics of a rule and updates its alert.
+ *
+ * The alert toggles once the condition towards the other state (raised while
+ * resolved, cleared while firing) held without interruption for the rule's
+ * duration.
+ *
+ * @param rule Rule const&: The rule.
+ * @param track Track&: The statistics and alert state of the subject.
+ * @param value double: The subject's current value of the rule's metric.
+ * @param subject std::string: The name of the subject for the alert.
+ * @param now Clock::time_point: The time of the sample.
+ * @param elapsed double: The seconds since the previous sample.
+ * @param alerts std::vector<AlertRecord>&: Receives a toggled alert.
+ */
+void RuleEngine::Evaluate(Rule const& rule, Track& track, double value,
+                          std::string const& subject, Clock::time_point now,
+                          double elapsed, std::vector<AlertRecord>& alerts) {
+  track.average.Add(value, elapsed);
+  double statistic = value;
+  if (rule.statistic == Rule::kAverage) {
+    statistic = track.average.Value();
+  } else if (rule.statistic == Rule::kQuantile) {
+    track.quantile.Add(value);
+    statistic = track.quantile.Value();
+  }
+  track.window.Push(statistic);
+  track.value = statistic;
+
+  bool raised{false};
+  bool cleared{false};
+  double const slope = track.window.Slope();
+  switch (rule.condition) {
+    case Rule::kAbove:
+      raised = statistic > rule.threshold;
+      cleared = statistic <= rule.clear;
+      break;
+    case Rule::kBelow:
+      raised = statistic < rule.threshold;
+      cleared = statistic >= rule.clear;
+      break;
+    case Rule::kRising:
+      raised = track.window.Full() && slope > 0;
+      cleared = slope <= 0;
+      break;
+    case Rule::kFalling:
+      raised = track.window.Full() && slope < 0;
+      cleared = slope >= 0;
+      break;
+  }
+
+  if (!(track.firing ? cleared : raised)) {
+    track.pending = false;
+    return;
+  }
+  if (!track.pending) {
+    track.pending = true;
+    track.since = now;
+  }
+  if (std::chrono::duration<double>(now - track.since).count() >=
+      rule.seconds) {
+    track.firing = !track.firing;
+    track.pending = false;
+    AlertRecord alert;
+    alert.firing = track.firing;
+    alert.rule = rule.text;
+    alert.subject = subject;
+    alert.value = statistic;
+    alerts.push_back(alert);
+  }
+}
+
+// Resolve the firing alerts of a subject that is no longer tracked
+void RuleEngine::Resolve(Subject& subject, std::string const& name,
+                         std::vector<AlertRecord>& alerts) {
+  for (std::size_t i = 0; i < subject.tracks.size(); ++i) {
+    if (subject.tracks[i].firing) {
+      AlertRecord alert;
+      alert.rule = rules_[i].text;
+      alert.subject = name;
+      alert.value = subject.tracks[i].value;
+      alerts.push_back(alert);
+    }
+  }
+}
+
+// Return fresh statistics for every rule
+std::vector<RuleEngine::Track> RuleEngine::Tracks() const {
+  std::vector<Track> tracks;
+  tracks.reserve(rules_.size());
+  for (Rule const& rule : rules_) {
+    tracks.emplace_back(rule);
+  }
+  return tracks;
+}
+
+/**
+ * @brief Starts the hook command for an alert without waiting for it.
+ *
+ * The command runs in /bin/sh with the alert in the environment variables
+ * MONITOR_ALERT_STATE (firing or resolved), MONITOR_ALERT_RULE,
+ * MONITOR_ALERT_SUBJECT and MONITOR_ALERT_VALUE. Its standard input and
+ * output are /dev/null so it cannot disturb the display. Alerts are dropped
+ * while kMaxHooks commands are still running.
+ *
+ * @param alert AlertRecord const&: The alert to pass to the command.
+ */
+void RuleEngine::RunHook(AlertRecord const& alert) {
+  if (hook_.empty() || hooks_.size() >= kMaxHooks) {
+    return;
+  }
+  std::ostringstream value;
+  value << alert.value;
+  std::vector<std::string> variables{
+      std::string("MONITOR_ALERT_STATE=") +
+          (alert.firing ? "firing" : "resolved"),
+      "MONITOR_ALERT_RULE=" + alert.rule,
+      "MONITOR_ALERT_SUBJECT=" + alert.subject,
+      "MONITOR_ALERT_VALUE=" + value.str()};
+  std::vector<char*> environment;
+  for (char** variable = environ; *variable != nullptr; ++variable) {
+    environment.push_back(*variable);
+  }
+  for (std::string& variable : variables) {
+    environment.push_back(&variable[0]);
+  }
+  environment.push_back(nullptr);
+
+  char shell[] = "sh";
+  char flag[] = "-c";
+  char* arguments[] = {shell, flag, &hook_[0], nullptr};
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+  pid_t pid;
+  if (posix_spawn(&pid, "/bin/sh", &actions, nullptr, arguments,
+                  environment.data()) == 0) {
+    hooks_.push_back(pid);
+  }
+  posix_spawn_file_actions_destroy(&actions);
+}
+
+// Collect the hook commands that have finished
+void RuleEngine::ReapHooks() {
+  for (std::size_t i = 0; i < hooks_.size();) {
+    if (waitpid(hooks_[i], nullptr, WNOHANG) != 0) {
+      hooks_[i] = hooks_.back();
+      hooks_.pop_back();
+    } else {
+      ++i;
+    }
+  }
+}
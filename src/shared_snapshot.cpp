@@ -0,0 +1,374 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "shared_snapshot.h"
+
+// A reader gives up after this many torn copies and keeps its old snapshot
+const int kMaxReadRetries{16};
+
+// Copy a string into a fixed size field, truncating it and keeping the NUL
+static void CopyField(char* field, std::size_t size, std::string const& value) {
+  std::size_t length = std::min(value.size(), size - 1);
+  std::memcpy(field, value.data(), length);
+  field[length] = '\0';
+}
+
+// Read a fixed size field that may lack the terminating NUL
+static void ReadField(std::string& value, char const* field,
+                      std::size_t size) {
+  value.assign(field, strnlen(field, size));
+}
+
+// Copy recent samples into a fixed size field, keeping the newest ones
+static void CopyHistory(std::uint8_t* field, std::uint8_t& length,
+                        std::size_t size,
+                        std::vector<std::uint8_t> const& samples) {
+  length = std::min(samples.size(), size);
+  std::memcpy(field, samples.data() + samples.size() - length, length);
+}
+
+// Read recent samples from a fixed size field
+static void ReadHistory(std::vector<std::uint8_t>& samples,
+                        std::uint8_t const* field, std::uint8_t length,
+                        std::size_t size) {
+  samples.assign(field, field + std::min<std::size_t>(length, size));
+}
+
+// Return the size of a segment holding up to capacity process records
+std::size_t SharedLayout::Size(std::uint32_t capacity) {
+  return sizeof(Header) + sizeof(System) + capacity * sizeof(Process);
+}
+
+// Unmap and remove the segment, readers that are attached keep their mapping
+SharedSnapshotWriter::~SharedSnapshotWriter() {
+  if (memory_ != nullptr) {
+    munmap(memory_, size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+/**
+ * @brief Creates the shared-memory segment and writes its layout header.
+ *
+ * The name follows shm_open conventions, so it must start with a slash.
+ * A segment left behind by a previous writer is resized and reused, and its
+ * sequence is continued.
+ *
+ * @param name std::string: The name of the segment, e.g. "/monitor".
+ * @param capacity std::size_t: The maximum number of process records, which
+ *        must fit the 32-bit capacity of the header.
+ * @return bool: True if the segment is ready for publishing, false otherwise.
+ */
+bool SharedSnapshotWriter::Open(std::string const& name,
+                                std::size_t capacity) {
+  if (capacity > std::numeric_limits<std::uint32_t>::max()) {
+    return false;
+  }
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  capacity_ = capacity;
+  size_ = SharedLayout::Size(capacity_);
+  // Never shrink the segment, readers may still map its old size
+  struct stat status;
+  if (fstat(fd, &status) == 0 &&
+      static_cast<std::size_t>(status.st_size) > size_) {
+    size_ = status.st_size;
+  }
+  void* memory = MAP_FAILED;
+  if (ftruncate(fd, size_) == 0) {
+    memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  name_ = name;
+  memory_ = memory;
+
+  auto* header = static_cast<SharedLayout::Header*>(memory_);
+  // Continue the sequence of a previous writer, so its readers see new ticks
+  std::uint64_t sequence{0};
+  if (header->magic == SharedLayout::kMagic) {
+    sequence = (header->sequence.load(std::memory_order_relaxed) + 1) & ~1ull;
+  }
+  // Invalidate the header while the layout is rewritten
+  header->magic = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->version = SharedLayout::kVersion;
+  header->header_size = sizeof(SharedLayout::Header);
+  header->system_size = sizeof(SharedLayout::System);
+  header->process_size = sizeof(SharedLayout::Process);
+  header->capacity = capacity_;
+  header->sequence.store(sequence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = SharedLayout::kMagic;
+  return true;
+}
+
+/**
+ * @brief Publishes a snapshot to all attached readers.
+ *
+ * The sequence is made odd before and even again after the records are
+ * copied, so readers can detect and retry a copy that overlapped a write.
+ * Processes beyond the segment's capacity are dropped.
+ *
+ * @param snapshot Snapshot const&: The snapshot of the current tick.
+ */
+void SharedSnapshotWriter::Publish(Snapshot const& snapshot) {
+  if (memory_ == nullptr) {
+    return;
+  }
+  auto* header = static_cast<SharedLayout::Header*>(memory_);
+  auto* system = reinterpret_cast<SharedLayout::System*>(header + 1);
+  auto* processes = reinterpret_cast<SharedLayout::Process*>(system + 1);
+
+  std::uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  system->cpu = snapshot.system.cpu;
+  system->memory = snapshot.system.memory;
+  system->uptime = snapshot.system.uptime;
+  system->total_processes = snapshot.system.total_processes;
+  system->running_processes = snapshot.system.running_processes;
+  system->process_ram = snapshot.system.process_ram;
+  system->string_memory = snapshot.system.string_memory;
+  system->string_referenced = snapshot.system.string_referenced;
+  system->process_count = std::min<std::size_t>(snapshot.processes.size(),
+                                                capacity_);
+  CopyField(system->operating_system, sizeof(system->operating_system),
+            snapshot.system.operating_system);
+  CopyField(system->kernel, sizeof(system->kernel), snapshot.system.kernel);
+  CopyField(system->filter, sizeof(system->filter), snapshot.system.filter);
+  CopyField(system->sort, sizeof(system->sort), snapshot.system.sort);
+  CopyHistory(system->cpu_history, system->cpu_history_length,
+              sizeof(system->cpu_history), snapshot.system.cpu_history);
+  CopyHistory(system->memory_history, system->memory_history_length,
+              sizeof(system->memory_history), snapshot.system.memory_history);
+  for (std::uint32_t i = 0; i < system->process_count; ++i) {
+    ProcessRecord const& record = snapshot.processes[i];
+    processes[i].pid = record.pid;
+    processes[i].cpu = record.cpu;
+    processes[i].wait = record.wait;
+    processes[i].voluntary_switches = record.voluntary_switches;
+    processes[i].involuntary_switches = record.involuntary_switches;
+    processes[i].processor = record.processor;
+    processes[i].outside_affinity = record.outside_affinity;
+    processes[i].migrations = record.migrations;
+    processes[i].ram = record.ram;
+    processes[i].uptime = record.uptime;
+    CopyField(processes[i].user, sizeof(processes[i].user), record.user);
+    CopyField(processes[i].command, sizeof(processes[i].command),
+              record.command);
+    CopyHistory(processes[i].cpu_history, processes[i].cpu_history_length,
+                sizeof(processes[i].cpu_history), record.cpu_history);
+  }
+
+  header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Unmap the segment
+SharedSnapshotReader::~SharedSnapshotReader() {
+  if (memory_ != nullptr) {
+    munmap(const_cast<void*>(memory_), size_);
+  }
+}
+
+/**
+ * @brief Maps a published segment read-only and checks its layout.
+ *
+ * The reader refuses segments whose magic, layout version or structure sizes
+ * differ from its own, because they were written by an incompatible monitor.
+ *
+ * @param name std::string: The name the writer published under.
+ * @param error std::string&: Receives the reason if attaching fails.
+ * @return bool: True if the reader is attached, false otherwise.
+ */
+bool SharedSnapshotReader::Attach(std::string const& name,
+                                  std::string& error) {
+  if (memory_ != nullptr) {
+    munmap(const_cast<void*>(memory_), size_);
+    memory_ = nullptr;
+  }
+  name_ = name;
+  last_sequence_ = 0;
+  int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    error = "no snapshot is published under " + name;
+    return false;
+  }
+  struct stat status;
+  void* memory = MAP_FAILED;
+  if (fstat(fd, &status) == 0 &&
+      static_cast<std::size_t>(status.st_size) >=
+          sizeof(SharedLayout::Header)) {
+    memory = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    error = "cannot map " + name;
+    return false;
+  }
+  memory_ = memory;
+  size_ = status.st_size;
+  device_ = status.st_dev;
+  inode_ = status.st_ino;
+
+  auto const* header = static_cast<SharedLayout::Header const*>(memory_);
+  if (header->magic != SharedLayout::kMagic) {
+    error = name + " is not a monitor snapshot";
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->version != SharedLayout::kVersion ||
+      header->header_size != sizeof(SharedLayout::Header) ||
+      header->system_size != sizeof(SharedLayout::System) ||
+      header->process_size != sizeof(SharedLayout::Process)) {
+    error = name + " uses layout version " + std::to_string(header->version) +
+            ", this monitor reads version " +
+            std::to_string(SharedLayout::kVersion);
+    return false;
+  }
+  capacity_ = header->capacity;
+  if (SharedLayout::Size(capacity_) > size_) {
+    error = name + " is truncated";
+    return false;
+  }
+  processes_.resize(capacity_);
+  return true;
+}
+
+// Return true if the header still describes the layout mapped at Attach
+bool SharedSnapshotReader::Current() const {
+  auto const* header = static_cast<SharedLayout::Header const*>(memory_);
+  return header->magic == SharedLayout::kMagic &&
+         header->version == SharedLayout::kVersion &&
+         header->header_size == sizeof(SharedLayout::Header) &&
+         header->system_size == sizeof(SharedLayout::System) &&
+         header->process_size == sizeof(SharedLayout::Process) &&
+         header->capacity == capacity_;
+}
+
+// Return true if the name now refers to another segment or a resized one
+bool SharedSnapshotReader::Replaced() const {
+  int fd = shm_open(name_.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status;
+  bool replaced = fstat(fd, &status) == 0 &&
+                  (status.st_dev != device_ || status.st_ino != inode_ ||
+                   static_cast<std::size_t>(status.st_size) != size_);
+  close(fd);
+  return replaced;
+}
+
+/**
+ * @brief Copies the latest published snapshot.
+ *
+ * The records are copied into scratch buffers and only converted once the
+ * sequence confirms that the copy did not overlap a write. The reader attaches
+ * again when the header no longer matches, when the sequence went backwards,
+ * or when an unchanged sequence belongs to a segment that a restarted writer
+ * has since replaced.
+ *
+ * @param snapshot Snapshot&: The snapshot to fill in.
+ * @param k std::size_t: The maximum number of processes to copy.
+ * @return bool: True if a new snapshot was copied, false if nothing changed
+ *         since the last call or the writer kept interfering.
+ */
+bool SharedSnapshotReader::Sample(Snapshot& snapshot, std::size_t k) {
+  if (name_.empty()) {
+    return false;
+  }
+  bool stale = memory_ == nullptr || !Current();
+  if (!stale) {
+    std::uint64_t sequence =
+        static_cast<SharedLayout::Header const*>(memory_)->sequence.load(
+            std::memory_order_acquire);
+    stale = sequence < last_sequence_ ||
+            (sequence == last_sequence_ && Replaced());
+  }
+  if (stale) {
+    std::string const name{name_};
+    std::string error;
+    if (!Attach(name, error)) {
+      return false;
+    }
+  }
+  auto const* header = static_cast<SharedLayout::Header const*>(memory_);
+  auto const* system =
+      reinterpret_cast<SharedLayout::System const*>(header + 1);
+  auto const* processes =
+      reinterpret_cast<SharedLayout::Process const*>(system + 1);
+
+  std::uint32_t count{0};
+  bool copied{false};
+  for (int retries = 0; retries < kMaxReadRetries && !copied; ++retries) {
+    std::uint64_t before = header->sequence.load(std::memory_order_acquire);
+    if (before == last_sequence_) {
+      return false;
+    }
+    if (before % 2 == 1) {
+      continue;
+    }
+    std::memcpy(&system_, system, sizeof(system_));
+    count = std::min<std::size_t>({system_.process_count, capacity_, k});
+    std::memcpy(processes_.data(), processes, count * sizeof(processes_[0]));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    copied = header->sequence.load(std::memory_order_relaxed) == before;
+    if (copied) {
+      last_sequence_ = before;
+    }
+  }
+  if (!copied) {
+    return false;
+  }
+
+  snapshot.system.cpu = system_.cpu;
+  snapshot.system.memory = system_.memory;
+  snapshot.system.uptime = system_.uptime;
+  snapshot.system.total_processes = system_.total_processes;
+  snapshot.system.running_processes = system_.running_processes;
+  snapshot.system.process_ram = system_.process_ram;
+  snapshot.system.string_memory = system_.string_memory;
+  snapshot.system.string_referenced = system_.string_referenced;
+  ReadField(snapshot.system.operating_system, system_.operating_system,
+            sizeof(system_.operating_system));
+  ReadField(snapshot.system.kernel, system_.kernel, sizeof(system_.kernel));
+  ReadField(snapshot.system.filter, system_.filter, sizeof(system_.filter));
+  ReadField(snapshot.system.sort, system_.sort, sizeof(system_.sort));
+  ReadHistory(snapshot.system.cpu_history, system_.cpu_history,
+              system_.cpu_history_length, sizeof(system_.cpu_history));
+  ReadHistory(snapshot.system.memory_history, system_.memory_history,
+              system_.memory_history_length, sizeof(system_.memory_history));
+  snapshot.processes.resize(count);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    ProcessRecord& record = snapshot.processes[i];
+    record.pid = processes_[i].pid;
+    record.cpu = processes_[i].cpu;
+    record.wait = processes_[i].wait;
+    record.voluntary_switches = processes_[i].voluntary_switches;
+    record.involuntary_switches = processes_[i].involuntary_switches;
+    record.processor = processes_[i].processor;
+    record.outside_affinity = processes_[i].outside_affinity;
+    record.migrations = processes_[i].migrations;
+    record.ram = processes_[i].ram;
+    record.uptime = processes_[i].uptime;
+    ReadField(record.user, processes_[i].user, sizeof(processes_[i].user));
+    ReadField(record.command, processes_[i].command,
+              sizeof(processes_[i].command));
+    ReadHistory(record.cpu_history, processes_[i].cpu_history,
+                processes_[i].cpu_history_length,
+                sizeof(processes_[i].cpu_history));
+  }
+  return true;
+}
@@ -0,0 +1,620 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "snapshot_stream.h"
+#include "socket_address.h"
+
+using namespace StreamProtocol;
+
+// Append an unsigned LEB128 varint
+static void PutVarint(std::string& out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+// Append a signed number as a zigzag varint, small magnitudes stay short
+static void PutSigned(std::string& out, long value) {
+  PutVarint(out, (static_cast<std::uint64_t>(value) << 1) ^
+                     static_cast<std::uint64_t>(value >> 63));
+}
+
+static void PutString(std::string& out, std::string const& value) {
+  PutVarint(out, value.size());
+  out += value;
+}
+
+// Reads the fields of a payload, turning bad once it runs past the end
+class PayloadReader {
+ public:
+  explicit PayloadReader(std::string_view data) : data_{data} {}
+
+  std::uint64_t Varint() {
+    std::uint64_t value{0};
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos_ >= data_.size()) {
+        good_ = false;
+        return 0;
+      }
+      std::uint8_t byte = data_[pos_++];
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    good_ = false;
+    return 0;
+  }
+
+  long Signed() {
+    std::uint64_t value = Varint();
+    return static_cast<long>((value >> 1) ^ (~(value & 1) + 1));
+  }
+
+  std::uint8_t Byte() {
+    if (pos_ >= data_.size()) {
+      good_ = false;
+      return 0;
+    }
+    return data_[pos_++];
+  }
+
+  void String(std::string& value) {
+    std::uint64_t length = Varint();
+    if (length > data_.size() - pos_) {
+      good_ = false;
+      return;
+    }
+    value.assign(data_.substr(pos_, length));
+    pos_ += length;
+  }
+
+  bool Good() const { return good_; }
+  bool Done() const { return pos_ == data_.size(); }
+
+ private:
+  std::string_view data_;
+  std::size_t pos_{0};
+  bool good_{true};
+};
+
+// Convert a fraction to units of 0.01%
+static std::uint32_t Quantize(float fraction) {
+  return std::lround(std::max(fraction, 0.0f) * 10000);
+}
+
+// Return the bit of a field if it changed
+static std::uint32_t Bit(bool changed, std::uint32_t bit) {
+  return changed ? bit : 0;
+}
+
+// Write the payload length in front of a frame built after 4 reserved bytes
+static void Seal(std::string& frame) {
+  std::uint32_t length = frame.size() - 4;
+  for (int i = 0; i < 4; ++i) {
+    frame[i] = static_cast<char>(length >> (8 * i));
+  }
+}
+
+// Append a sample to a history, keeping at most limit samples
+static void Append(std::vector<std::uint8_t>& history, std::uint32_t units,
+                   std::size_t limit) {
+  history.push_back((units + 50) / 100);
+  if (history.size() > limit) {
+    history.erase(history.begin());
+  }
+}
+
+// Build the frame introducing a host
+void StreamProtocol::Hello(std::string const& host, std::string& frame) {
+  frame.assign(4, '\0');
+  frame += static_cast<char>(kHello);
+  PutVarint(frame, kVersion);
+  PutString(frame, host);
+  Seal(frame);
+}
+
+/**
+ * @brief Builds the frame of a snapshot with only the changed fields.
+ *
+ * The system and each process are compared with the state last sent, which
+ * is then replaced by the new state. Processes are sent in the order of the
+ * snapshot; one missing from the previous state is sent with all fields.
+ *
+ * @param snapshot Snapshot const&: The snapshot to send.
+ * @param previous HostState&: The state last sent, updated to this snapshot.
+ * @param frame std::string&: Receives the frame.
+ */
+void StreamProtocol::Encode(Snapshot const& snapshot, HostState& previous,
+                            std::string& frame) {
+  frame.assign(4, '\0');
+  frame += static_cast<char>(kSnapshot);
+
+  SystemRecord const& record = snapshot.system;
+  SystemState& system = previous.system;
+  SystemState const now{Quantize(record.cpu),        Quantize(record.memory),
+                        record.uptime,               record.total_processes,
+                        record.running_processes,    record.process_ram,
+                        record.operating_system,     record.kernel};
+  std::uint32_t const mask =
+      Bit(now.cpu != system.cpu, kCpu) |
+      Bit(now.memory != system.memory, kMemory) |
+      Bit(now.uptime != system.uptime, kUptime) |
+      Bit(now.total_processes != system.total_processes, kTotalProcesses) |
+      Bit(now.running_processes != system.running_processes,
+          kRunningProcesses) |
+      Bit(now.process_ram != system.process_ram, kProcessRam) |
+      Bit(now.operating_system != system.operating_system, kOperatingSystem) |
+      Bit(now.kernel != system.kernel, kKernel);
+  PutVarint(frame, mask);
+  if (mask & kCpu) PutVarint(frame, now.cpu);
+  if (mask & kMemory) PutVarint(frame, now.memory);
+  if (mask & kUptime) PutSigned(frame, now.uptime);
+  if (mask & kTotalProcesses) PutSigned(frame, now.total_processes);
+  if (mask & kRunningProcesses) PutSigned(frame, now.running_processes);
+  if (mask & kProcessRam) PutSigned(frame, now.process_ram);
+  if (mask & kOperatingSystem) PutString(frame, now.operating_system);
+  if (mask & kKernel) PutString(frame, now.kernel);
+  system = now;
+
+  std::unordered_map<int, ProcessState> processes;
+  previous.pids.clear();
+  PutVarint(frame, snapshot.processes.size());
+  for (ProcessRecord const& process : snapshot.processes) {
+    ProcessState state{Quantize(process.cpu),
+                       process.ram,
+                       record.uptime - process.uptime,
+                       process.user,
+                       process.command,
+                       Quantize(process.wait),
+                       static_cast<std::uint32_t>(
+                           std::lround(process.voluntary_switches)),
+                       static_cast<std::uint32_t>(
+                           std::lround(process.involuntary_switches)),
+                       process.processor,
+                       process.migrations,
+                       process.outside_affinity};
+    std::uint32_t fields{kAllProcessFields};
+    auto found = previous.processes.find(process.pid);
+    if (found != previous.processes.end()) {
+      ProcessState const& old = found->second;
+      fields = Bit(state.cpu != old.cpu, kProcessCpu) |
+               Bit(state.ram != old.ram, kRam) |
+               Bit(state.started != old.started, kStarted) |
+               Bit(state.user != old.user, kUser) |
+               Bit(state.command != old.command, kCommand) |
+               Bit(state.wait != old.wait, kWait) |
+               Bit(state.voluntary_switches != old.voluntary_switches,
+                   kVoluntarySwitches) |
+               Bit(state.involuntary_switches != old.involuntary_switches,
+                   kInvoluntarySwitches) |
+               Bit(state.processor != old.processor, kProcessor) |
+               Bit(state.migrations != old.migrations, kMigrations) |
+               Bit(state.outside_affinity != old.outside_affinity,
+                   kOutsideAffinity);
+    }
+    PutVarint(frame, process.pid);
+    PutVarint(frame, fields);
+    if (fields & kProcessCpu) PutVarint(frame, state.cpu);
+    if (fields & kRam) PutSigned(frame, state.ram);
+    if (fields & kStarted) PutSigned(frame, state.started);
+    if (fields & kUser) PutString(frame, state.user);
+    if (fields & kCommand) PutString(frame, state.command);
+    if (fields & kWait) PutVarint(frame, state.wait);
+    if (fields & kVoluntarySwitches) {
+      PutVarint(frame, state.voluntary_switches);
+    }
+    if (fields & kInvoluntarySwitches) {
+      PutVarint(frame, state.involuntary_switches);
+    }
+    if (fields & kProcessor) PutSigned(frame, state.processor);
+    if (fields & kMigrations) PutSigned(frame, state.migrations);
+    if (fields & kOutsideAffinity) {
+      frame += static_cast<char>(state.outside_affinity);
+    }
+    previous.pids.push_back(process.pid);
+    processes[process.pid] = std::move(state);
+  }
+  previous.processes.swap(processes);
+  Seal(frame);
+}
+
+/**
+ * @brief Applies the payload of one frame to the state of a host.
+ *
+ * @param payload std::string_view: The payload, starting with its type.
+ * @param host HostState&: The state of the sending host.
+ * @return bool: True if the payload was valid, false otherwise.
+ */
+bool StreamProtocol::Decode(std::string_view payload, HostState& host) {
+  PayloadReader reader{payload};
+  std::uint8_t const type = reader.Byte();
+  if (type == kHello) {
+    if (reader.Varint() != kVersion) {
+      return false;
+    }
+    reader.String(host.name);
+    return reader.Good() && reader.Done();
+  }
+  if (type != kSnapshot) {
+    return false;
+  }
+
+  SystemState& system = host.system;
+  std::uint64_t const mask = reader.Varint();
+  if (mask & kCpu) system.cpu = reader.Varint();
+  if (mask & kMemory) system.memory = reader.Varint();
+  if (mask & kUptime) system.uptime = reader.Signed();
+  if (mask & kTotalProcesses) system.total_processes = reader.Signed();
+  if (mask & kRunningProcesses) system.running_processes = reader.Signed();
+  if (mask & kProcessRam) system.process_ram = reader.Signed();
+  if (mask & kOperatingSystem) reader.String(system.operating_system);
+  if (mask & kKernel) reader.String(system.kernel);
+
+  std::uint64_t const count = reader.Varint();
+  if (!reader.Good() || count > payload.size()) {
+    return false;
+  }
+  std::unordered_map<int, ProcessState> processes;
+  host.pids.clear();
+  for (std::uint64_t i = 0; i < count && reader.Good(); ++i) {
+    int const pid = reader.Varint();
+    std::uint64_t const fields = reader.Varint();
+    ProcessState state;
+    auto found = host.processes.find(pid);
+    if (found != host.processes.end()) {
+      state = std::move(found->second);
+    }
+    if (fields & kProcessCpu) state.cpu = reader.Varint();
+    if (fields & kRam) state.ram = reader.Signed();
+    if (fields & kStarted) state.started = reader.Signed();
+    if (fields & kUser) reader.String(state.user);
+    if (fields & kCommand) reader.String(state.command);
+    if (fields & kWait) state.wait = reader.Varint();
+    if (fields & kVoluntarySwitches) state.voluntary_switches = reader.Varint();
+    if (fields & kInvoluntarySwitches) {
+      state.involuntary_switches = reader.Varint();
+    }
+    if (fields & kProcessor) state.processor = reader.Signed();
+    if (fields & kMigrations) state.migrations = reader.Signed();
+    if (fields & kOutsideAffinity) state.outside_affinity = reader.Byte() != 0;
+    host.pids.push_back(pid);
+    processes[pid] = std::move(state);
+  }
+  host.processes.swap(processes);
+  return reader.Good() && reader.Done();
+}
+
+/**
+ * @brief Constructs a sender for the given collector address.
+ *
+ * The connection is opened by the first Publish.
+ *
+ * @param address std::string: "unix:/path" or "[host:]port" of the collector.
+ * @param host std::string: The name this monitor is shown under.
+ * @param k std::size_t: The number of top processes by CPU to send.
+ */
+SnapshotSender::SnapshotSender(std::string const& address,
+                               std::string const& host, std::size_t k)
+    : address_{address}, host_{host}, k_{k} {}
+
+// Close the connection
+SnapshotSender::~SnapshotSender() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+/**
+ * @brief Sends the changes of a snapshot to the collector.
+ *
+ * Without a connection, one attempt per call is made to connect; after it
+ * the host is introduced and the next snapshot is sent completely. A failed
+ * send drops the connection. The collector ranks all hosts by CPU, so the
+ * top k processes by CPU are sent whatever the local ranking; a snapshot
+ * ranked by another column must hold every visible process for them to be
+ * found.
+ *
+ * @param snapshot Snapshot const&: The snapshot of the current tick.
+ */
+void SnapshotSender::Publish(Snapshot const& snapshot) {
+  if (fd_ < 0) {
+    fd_ = SocketAddress::Connect(address_);
+    if (fd_ < 0) {
+      return;
+    }
+    sent_ = StreamProtocol::HostState{};
+    StreamProtocol::Hello(host_, frame_);
+    if (!SocketAddress::SendAll(fd_, frame_.data(), frame_.size())) {
+      close(fd_);
+      fd_ = -1;
+      return;
+    }
+  }
+  auto busier = [](ProcessRecord const& a, ProcessRecord const& b) {
+    return a.cpu != b.cpu ? a.cpu > b.cpu : a.pid < b.pid;
+  };
+  std::vector<ProcessRecord> const& processes = snapshot.processes;
+  if (processes.size() <= k_ &&
+      std::is_sorted(processes.begin(), processes.end(), busier)) {
+    StreamProtocol::Encode(snapshot, sent_, frame_);
+  } else {
+    order_.resize(processes.size());
+    std::iota(order_.begin(), order_.end(), 0);
+    std::size_t const count = std::min(k_, processes.size());
+    std::partial_sort(order_.begin(), order_.begin() + count, order_.end(),
+                      [&processes, &busier](std::size_t a, std::size_t b) {
+                        return busier(processes[a], processes[b]);
+                      });
+    ranked_.system = snapshot.system;
+    ranked_.processes.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      ranked_.processes[i] = processes[order_[i]];
+    }
+    StreamProtocol::Encode(ranked_, sent_, frame_);
+  }
+  if (!SocketAddress::SendAll(fd_, frame_.data(), frame_.size())) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+/**
+ * @brief Constructs a collector for the given address.
+ *
+ * The socket is not opened until Start is called.
+ *
+ * @param address std::string: "unix:/path" or "[host:]port".
+ */
+SnapshotCollector::SnapshotCollector(std::string const& address)
+    : address_{address} {}
+
+// Stop collecting and close all connections
+SnapshotCollector::~SnapshotCollector() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  for (Connection const& connection : connections_) {
+    close(connection.fd);
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
+  SocketAddress::Remove(address_);
+}
+
+// Open the listening socket and start accepting monitors
+bool SnapshotCollector::Start() {
+  listen_fd_ = SocketAddress::Listen(address_);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread(&SnapshotCollector::Serve, this);
+  return true;
+}
+
+/**
+ * @brief Merges the latest state of all hosts into a snapshot.
+ *
+ * The processes of each host are ranked by CPU as they arrive, in case an
+ * older monitor sent them in its own order, so the global top processes are
+ * found with a k-way merge over a heap of the hosts' next
+ * processes, touching no more than k processes in total. The system record
+ * sums the process counts and averages the utilization over the hosts.
+ *
+ * @param snapshot Snapshot&: Receives the merged snapshot.
+ * @param k std::size_t: The number of top processes overall.
+ * @return bool: True if a host changed since the previous call.
+ */
+bool SnapshotCollector::Sample(Snapshot& snapshot, std::size_t k) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!updated_) {
+    return false;
+  }
+  updated_ = false;
+
+  SystemRecord& system = snapshot.system;
+  system = SystemRecord{};
+  snapshot.hosts.clear();
+  snapshot.processes.clear();
+  std::size_t hosts{0};
+  for (Connection const& connection : connections_) {
+    if (!connection.greeted || connection.messages == 0) {
+      continue;
+    }
+    StreamProtocol::SystemState const& state = connection.host.system;
+    HostRecord host;
+    host.name = connection.host.name;
+    host.cpu = state.cpu / 10000.0f;
+    host.memory = state.memory / 10000.0f;
+    host.uptime = state.uptime;
+    host.running_processes = state.running_processes;
+    host.received = connection.received;
+    host.messages = connection.messages;
+    snapshot.hosts.push_back(host);
+    system.cpu += host.cpu;
+    system.memory += host.memory;
+    system.uptime = std::max(system.uptime, state.uptime);
+    system.total_processes += state.total_processes;
+    system.running_processes += state.running_processes;
+    system.process_ram += state.process_ram;
+    ++hosts;
+  }
+  if (hosts > 0) {
+    system.cpu /= hosts;
+    system.memory /= hosts;
+  }
+  system.operating_system = std::to_string(hosts) + " hosts";
+  cpu_history_.Push(system.cpu);
+  memory_history_.Push(system.memory);
+  cpu_history_.CopyTo(system.cpu_history);
+  memory_history_.CopyTo(system.memory_history);
+
+  // The next process of each host, ordered by CPU and then by host
+  using Head = std::pair<std::size_t, std::size_t>;  // connection, position
+  auto lower = [this](Head const& a, Head const& b) {
+    auto cpu = [this](Head const& head) {
+      Connection const& connection = connections_[head.first];
+      return connection.host.processes.at(connection.ranking[head.second]).cpu;
+    };
+    return cpu(a) != cpu(b) ? cpu(a) < cpu(b) : a.first > b.first;
+  };
+  std::priority_queue<Head, std::vector<Head>, decltype(lower)> heads(lower);
+  for (std::size_t i = 0; i < connections_.size(); ++i) {
+    if (connections_[i].greeted && !connections_[i].ranking.empty()) {
+      heads.emplace(i, 0);
+    }
+  }
+  while (!heads.empty() && snapshot.processes.size() < k) {
+    Head const head = heads.top();
+    heads.pop();
+    Connection const& connection = connections_[head.first];
+    int const pid = connection.ranking[head.second];
+    StreamProtocol::ProcessState const& state =
+        connection.host.processes.at(pid);
+    ProcessRecord record;
+    record.pid = pid;
+    record.cpu = state.cpu / 10000.0f;
+    record.wait = state.wait / 10000.0f;
+    record.voluntary_switches = state.voluntary_switches;
+    record.involuntary_switches = state.involuntary_switches;
+    record.processor = state.processor;
+    record.migrations = state.migrations;
+    record.outside_affinity = state.outside_affinity;
+    record.ram = state.ram;
+    record.uptime = connection.host.system.uptime - state.started;
+    record.user = state.user;
+    record.command = state.command;
+    record.host = connection.host.name;
+    auto history = connection.histories.find(pid);
+    if (history != connection.histories.end()) {
+      record.cpu_history = history->second;
+    }
+    snapshot.processes.push_back(std::move(record));
+    if (head.second + 1 < connection.ranking.size()) {
+      heads.emplace(head.first, head.second + 1);
+    }
+  }
+  return true;
+}
+
+// Accept monitors and read their streams until the collector is destroyed
+void SnapshotCollector::Serve() {
+  std::vector<pollfd> fds;
+  while (running_) {
+    fds.assign(1, pollfd{listen_fd_, POLLIN, 0});
+    for (Connection const& connection : connections_) {
+      fds.push_back(pollfd{connection.fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), 200) <= 0) {
+      continue;
+    }
+    // Walking backwards, a dropped connection doesn't shift the ones ahead
+    for (std::size_t i = connections_.size(); i-- > 0;) {
+      if (fds[i + 1].revents != 0 && !Receive(connections_[i])) {
+        close(connections_[i].fd);
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.erase(connections_.begin() + i);
+        updated_ = true;
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd >= 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.emplace_back();
+        connections_.back().fd = fd;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Reads from a monitor and applies its complete frames.
+ *
+ * A stream must start with a hello; malformed or oversized frames drop the
+ * connection. Every snapshot also appends to the recent CPU samples of the
+ * host's processes and ranks them by CPU for the merge, since a host may
+ * rank by another column.
+ *
+ * @param connection Connection&: The connection that became readable.
+ * @return bool: False if the connection is closed or broken.
+ */
+bool SnapshotCollector::Receive(Connection& connection) {
+  char data[65536];
+  ssize_t count = read(connection.fd, data, sizeof(data));
+  if (count <= 0) {
+    return false;
+  }
+  connection.buffer.append(data, count);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connection.received += count;
+  }
+
+  std::size_t offset{0};
+  bool valid{true};
+  while (valid && connection.buffer.size() - offset >= 4) {
+    std::uint32_t length{0};
+    for (int i = 0; i < 4; ++i) {
+      length |= static_cast<std::uint32_t>(
+                    static_cast<std::uint8_t>(connection.buffer[offset + i]))
+                << (8 * i);
+    }
+    if (length == 0 || length > kMaxFrame) {
+      return false;
+    }
+    if (connection.buffer.size() - offset - 4 < length) {
+      break;
+    }
+    std::string_view payload(connection.buffer.data() + offset + 4, length);
+    offset += 4 + length;
+    bool const hello = payload[0] == kHello;
+    if (hello == connection.greeted) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    valid = Decode(payload, connection.host);
+    connection.greeted = true;
+    if (!valid) {
+      // A broken message may leave PIDs without their fields
+      connection.ranking.clear();
+    }
+    if (valid && !hello) {
+      ++connection.messages;
+      StreamProtocol::HostState const& host = connection.host;
+      for (int pid : host.pids) {
+        Append(connection.histories[pid], host.processes.at(pid).cpu,
+               kProcessHistory);
+      }
+      connection.ranking = host.pids;
+      std::sort(connection.ranking.begin(), connection.ranking.end(),
+                [&host](int a, int b) {
+                  std::uint32_t const cpu_a = host.processes.at(a).cpu;
+                  std::uint32_t const cpu_b = host.processes.at(b).cpu;
+                  return cpu_a != cpu_b ? cpu_a > cpu_b : a < b;
+                });
+      for (auto history = connection.histories.begin();
+           history != connection.histories.end();) {
+        history = host.processes.count(history->first) == 0
+                      ? connection.histories.erase(history)
+                      : std::next(history);
+      }
+    }
+    updated_ = true;
+  }
+  connection.buffer.erase(0, offset);
+  return valid;
+}
@@ -0,0 +1,165 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "socket_address.h"
+
+// Socket address of either family, filled in by Resolve
+struct Resolved {
+  int family{AF_UNSPEC};
+  sockaddr_un unix_address{};
+  sockaddr_in inet_address{};
+
+  sockaddr const* Address() const {
+    return family == AF_UNIX
+               ? reinterpret_cast<sockaddr const*>(&unix_address)
+               : reinterpret_cast<sockaddr const*>(&inet_address);
+  }
+  socklen_t Length() const {
+    return family == AF_UNIX ? sizeof(unix_address) : sizeof(inet_address);
+  }
+};
+
+// Parse an address, return false with the reason if it is malformed
+static bool Resolve(std::string const& address, Resolved& resolved,
+                    std::string& error) {
+  if (address.rfind("unix:", 0) == 0) {
+    std::string path = address.substr(5);
+    if (path.empty() || path.size() >= sizeof(resolved.unix_address.sun_path)) {
+      error = "the socket path must have 1 to " +
+              std::to_string(sizeof(resolved.unix_address.sun_path) - 1) +
+              " characters";
+      return false;
+    }
+    resolved.family = AF_UNIX;
+    resolved.unix_address.sun_family = AF_UNIX;
+    std::strcpy(resolved.unix_address.sun_path, path.c_str());
+    return true;
+  }
+  std::string host{"127.0.0.1"};
+  std::string port = address;
+  std::size_t colon = address.rfind(':');
+  if (colon != std::string::npos) {
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+  }
+  // At most 5 digits, so the number cannot overflow before the range check
+  long number{0};
+  if (port.empty() || port.size() > 5 ||
+      !std::all_of(port.begin(), port.end(), isdigit) ||
+      (number = std::strtol(port.c_str(), nullptr, 10)) < 1 ||
+      number > 65535) {
+    error = "the port must be a number from 1 to 65535";
+    return false;
+  }
+  if (inet_pton(AF_INET, host.c_str(), &resolved.inet_address.sin_addr) != 1) {
+    error = "'" + host + "' is not an IPv4 address";
+    return false;
+  }
+  resolved.family = AF_INET;
+  resolved.inet_address.sin_family = AF_INET;
+  resolved.inet_address.sin_port = htons(number);
+  return true;
+}
+
+/**
+ * @brief Checks that an address is well-formed, without opening a socket.
+ *
+ * @param address std::string: "unix:/path" or "[host:]port".
+ * @param error std::string&: Receives the reason if the address is invalid.
+ * @return bool: True if the address is valid, false otherwise.
+ */
+bool SocketAddress::Check(std::string const& address, std::string& error) {
+  Resolved resolved;
+  return Resolve(address, resolved, error);
+}
+
+/**
+ * @brief Opens a listening socket on the given address.
+ *
+ * For a Unix domain socket a stale socket file at the same path is removed
+ * first. For TCP the address may be reused right after a restart.
+ *
+ * @param address std::string: "unix:/path" or "[host:]port".
+ * @return int: The listening socket, or -1 if it cannot be opened.
+ */
+int SocketAddress::Listen(std::string const& address) {
+  Resolved resolved;
+  std::string error;
+  if (!Resolve(address, resolved, error)) {
+    return -1;
+  }
+  int fd = socket(resolved.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  int reuse{1};
+  if (resolved.family == AF_UNIX) {
+    unlink(resolved.unix_address.sun_path);
+  } else if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                        sizeof(reuse)) != 0) {
+    close(fd);
+    return -1;
+  }
+  if (bind(fd, resolved.Address(), resolved.Length()) != 0 ||
+      listen(fd, 16) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Connects a stream socket to the given address.
+ *
+ * Sends time out after a second, so a stalled peer cannot block the caller
+ * for longer.
+ *
+ * @param address std::string: "unix:/path" or "[host:]port".
+ * @return int: The connected socket, or -1 if the connection failed.
+ */
+int SocketAddress::Connect(std::string const& address) {
+  Resolved resolved;
+  std::string error;
+  if (!Resolve(address, resolved, error)) {
+    return -1;
+  }
+  int fd = socket(resolved.family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  timeval timeout{1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if (connect(fd, resolved.Address(), resolved.Length()) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Remove the socket file of a Unix domain socket address
+void SocketAddress::Remove(std::string const& address) {
+  if (address.rfind("unix:", 0) == 0) {
+    unlink(address.substr(5).c_str());
+  }
+}
+
+// Send a whole buffer, return false if the peer is gone or stalled
+bool SocketAddress::SendAll(int fd, char const* data, std::size_t size) {
+  std::size_t sent{0};
+  while (sent < size) {
+    ssize_t count = send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+    if (count <= 0) {
+      return false;
+    }
+    sent += count;
+  }
+  return true;
+}
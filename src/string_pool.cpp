@@ -0,0 +1,91 @@
+#include <string>
+
+#include "string_pool.h"
+
+/**
+ * @brief Returns the ID of a string and takes a reference to it.
+ *
+ * A string that is not in the pool yet is copied into a free entry, or into
+ * a new one if no entry is free. Every call must be matched by a call to
+ * Release once the ID is no longer used.
+ *
+ * @param value std::string_view: The string to intern.
+ * @return std::uint32_t: The ID under which the string is stored.
+ */
+std::uint32_t StringPool::Intern(std::string_view value) {
+  ++references_;
+  referenced_bytes_ += value.size();
+  auto found = ids_.find(value);
+  if (found != ids_.end()) {
+    ++entries_[found->second].references;
+    return found->second;
+  }
+  std::uint32_t id;
+  if (free_.empty()) {
+    id = entries_.size();
+    entries_.push_back(Entry{std::string(value), 1});
+  } else {
+    id = free_.back();
+    free_.pop_back();
+    entries_[id].value.assign(value);
+    entries_[id].references = 1;
+  }
+  stored_bytes_ += value.size();
+  ids_.emplace(entries_[id].value, id);
+  return id;
+}
+
+/**
+ * @brief Drops one reference to a string.
+ *
+ * When the last reference is dropped the string's memory is released and
+ * its ID becomes free for another string.
+ *
+ * @param id std::uint32_t: An ID returned by Intern.
+ */
+void StringPool::Release(std::uint32_t id) {
+  Entry& entry = entries_[id];
+  --references_;
+  referenced_bytes_ -= entry.value.size();
+  if (--entry.references > 0) {
+    return;
+  }
+  ids_.erase(entry.value);
+  stored_bytes_ -= entry.value.size();
+  std::string().swap(entry.value);
+  free_.push_back(id);
+}
+
+// Return the string stored under the given ID
+std::string_view StringPool::Get(std::uint32_t id) const {
+  return entries_[id].value;
+}
+
+/**
+ * @brief Reports how much memory the pool uses.
+ *
+ * The memory estimate counts the entries, the heap buffers of the strings,
+ * the free list and the nodes and buckets of the index. referenced_bytes is
+ * what the same strings would take if every reference kept its own copy.
+ *
+ * @return StringPool::Usage: The current memory use of the pool.
+ */
+StringPool::Usage StringPool::MemoryUsage() const {
+  Usage usage;
+  usage.strings = ids_.size();
+  usage.references = references_;
+  usage.stored_bytes = stored_bytes_;
+  usage.referenced_bytes = referenced_bytes_;
+  usage.memory_bytes = entries_.size() * sizeof(Entry) +
+                       free_.capacity() * sizeof(std::uint32_t) +
+                       ids_.bucket_count() * sizeof(void*) +
+                       ids_.size() * (sizeof(decltype(ids_)::value_type) +
+                                      sizeof(void*) + sizeof(std::size_t));
+  for (Entry const& entry : entries_) {
+    // Short strings live inside the entry, longer ones on the heap
+    if (entry.value.capacity() > std::string().capacity()) {
+      usage.memory_bytes += entry.value.capacity() + 1;
+    }
+  }
+  return usage;
+}
@@ -4,9 +4,10 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <algorithm>  // For std::sort
+#include <algorithm>  // For std::min
 
 #include "process.h"
+#include "process_table.h"
 #include "processor.h"
 #include "system.h"
 #include "linux_parser.h"
@@ -18,17 +19,12 @@ using std::size_t;
 // Return the system's CPU
 Processor& System::Cpu() { return cpu_; }
 
-// Return a vector container composed of the system's processses
-std::vector<Process>& System::Processes() {
-    std::vector<int> pids = LinuxParser::Pids();
-    processes_.clear(); // Clear the existing processes before updating to ensure it is up-to-date
-    for (int pid : pids){
-        processes_.emplace_back(pid); // Construct a Process object in place for each PID
-    } 
-    // Sort the processes in descending order of CPU utilization)
-    // By default, std::sort uses the less-than operator (<) to compare elements. 
-    // based on the overloaded < operator in the Process class
-    std::sort(processes_.begin(), processes_.end(), std::greater<Process>());
+// Return the table of the system's processes, updated to the current processes
+ProcessTable& System::Processes() {
+    // If /proc cannot be listed the table keeps the previous processes
+    if (LinuxParser::Pids(pids_)) {
+        processes_.Update(pids_);
+    }
     return processes_; 
 }
 
@@ -66,4 +62,109 @@ int System::TotalProcesses() {
 // Return the number of seconds since the system started running
 long int System::UpTime() { 
     return LinuxParser::UpTime(); 
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Samples the system and its top processes into a snapshot.
+ *
+ * This function reads every metric exactly once, so the snapshot can be
+ * rendered or exported any number of times without going back to /proc.
+ * The process records are reused between ticks to keep their string buffers.
+ * Only the processes passing the filter are ranked, by the sort column, and
+ * counted in process_ram.
+ *
+ * @param snapshot Snapshot&: The snapshot to fill in.
+ * @param k std::size_t: The maximum number of processes to include.
+ * @return bool: Always true, the local system always has a new snapshot.
+ */
+bool System::Sample(Snapshot& snapshot, std::size_t k) {
+    snapshot.system.operating_system = OperatingSystem();
+    snapshot.system.filter = processes_.FilterExpression();
+    snapshot.system.sort = processes_.SortColumn();
+    snapshot.system.kernel = Kernel();
+    snapshot.system.cpu = cpu_.Utilization();
+    snapshot.system.memory = MemoryUtilization();
+    cpu_history_.Push(snapshot.system.cpu);
+    memory_history_.Push(snapshot.system.memory);
+    cpu_history_.CopyTo(snapshot.system.cpu_history);
+    memory_history_.CopyTo(snapshot.system.memory_history);
+    snapshot.system.uptime = UpTime();
+    snapshot.system.total_processes = TotalProcesses();
+    snapshot.system.running_processes = RunningProcesses();
+    numa_.Sample(snapshot.nodes);
+
+    ProcessTable& processes = Processes();
+    snapshot.system.process_ram = processes.TotalRss() / 1024;
+    StringPool::Usage const strings = processes.StringUsage();
+    snapshot.system.string_memory = strings.memory_bytes;
+    snapshot.system.string_referenced = strings.referenced_bytes;
+    processes.Occupancy(occupancy_);
+    for (NodeRecord& node : snapshot.nodes) {
+        node.occupancy.resize(node.cpus.size());
+        for (size_t i = 0; i < node.cpus.size(); ++i) {
+            size_t const cpu = node.cpus[i];
+            node.occupancy[i] = cpu < occupancy_.size() ? occupancy_[cpu] : 0;
+        }
+    }
+    processes.TopK(k, ranking_);
+    snapshot.processes.resize(ranking_.size());
+    for (size_t i = 0; i < ranking_.size(); ++i) {
+        Process const process = processes[ranking_[i]];
+        ProcessRecord& record = snapshot.processes[i];
+        record.pid = process.Pid();
+        record.cpu = process.CpuUtilization();
+        record.wait = process.Wait();
+        record.voluntary_switches = process.VoluntarySwitches();
+        record.involuntary_switches = process.InvoluntarySwitches();
+        record.processor = process.Processor();
+        record.migrations = process.Migrations();
+        record.outside_affinity = process.OutsideAffinity();
+        record.ram = process.Ram();
+        record.uptime = process.UpTime();
+        record.user.assign(process.User());
+        record.command.assign(process.Command());
+        process.CpuHistory(record.cpu_history);
+    }
+    return true;
+}
+
+// Show only the processes matching the expression from the next sample on
+bool System::SetFilter(std::string const& expression, std::string& error) {
+    return processes_.SetFilter(expression, error);
+}
+
+// Rank the processes by the column from the next sample on
+bool System::SetSort(std::string const& column, std::string& error) {
+    return processes_.SetSort(column, error);
+}
+
+/**
+ * @brief Reads the memory of a process per NUMA node.
+ *
+ * Only done on request, reading numa_maps walks the process's page tables.
+ *
+ * @param pid int: The process ID.
+ * @param kilobytes std::vector<long>&: Receives the KB per node, indexed by
+ *        node ID.
+ * @param error std::string&: Receives the reason if the file is unreadable.
+ * @return bool: True if the memory was read, false otherwise.
+ */
+bool System::NumaPages(int pid, std::vector<long>& kilobytes,
+                       std::string& error) {
+    if (!LinuxParser::NumaPages(pid, kilobytes)) {
+        error = "cannot read " + LinuxParser::kProcDirectory +
+                std::to_string(pid) + LinuxParser::kNumaMapsFilename;
+        return false;
+    }
+    return true;
+}
+
+// Return true if the process was listed by the last sample, even if hidden
+bool System::Running(int pid) const {
+    return processes_.Contains(pid);
+}
+
+// Read the files of the processes through io_uring if the kernel supports it
+bool System::UseBatchReads() {
+    return processes_.UseBatchReads();
+}
@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "filter.h"
+
+// Deep nesting is refused instead of recursing without bound
+TEST(Filter, RefusesDeepNesting) {
+  Filter filter;
+  std::string error;
+  EXPECT_TRUE(filter.Compile(std::string(64, '(') + "pid==1" +
+                                 std::string(64, ')'),
+                             error))
+      << error;
+  EXPECT_FALSE(filter.Compile(std::string(65, '(') + "pid==1" +
+                                  std::string(65, ')'),
+                              error));
+  EXPECT_FALSE(filter.Compile(std::string(100000, '!') + "pid==1", error));
+  EXPECT_NE(error.find("nested deeper"), std::string::npos) << error;
+}
+
+// Bytes outside ASCII are plain text in values and errors elsewhere
+TEST(Filter, AcceptsNonAsciiText) {
+  Filter filter;
+  std::string error;
+  ASSERT_TRUE(filter.Compile("cmd~caf\xc3\xa9", error)) << error;
+  Filter::Fields fields;
+  fields.command = "caf\xc3\xa9 --serve";
+  EXPECT_EQ(filter.Evaluate(fields, Filter::kCmdline), Filter::kTrue);
+  EXPECT_FALSE(filter.Compile("\xc3\xa9==1", error));
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "process_table.h"
+
+namespace {
+
+// Processes spinning on a CPU until the fixture ends
+class BusyProcesses : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < 2; ++i) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        while (1) {
+        }
+      }
+      ASSERT_GT(pid, 0);
+      pids_.push_back(pid);
+    }
+    std::sort(pids_.begin(), pids_.end());
+  }
+
+  void TearDown() override {
+    for (pid_t pid : pids_) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+    }
+  }
+
+  // Update the table twice, so the processes have CPU deltas
+  void Sample(ProcessTable& table) {
+    table.Update(pids_);
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+    table.Update(pids_);
+  }
+
+  std::vector<int> pids_{};
+};
+
+int Total(std::vector<std::uint8_t> const& cpus) {
+  return std::accumulate(cpus.begin(), cpus.end(), 0);
+}
+
+}  // namespace
+
+// The heatmap counts every visible process, not only the top ones shown
+TEST_F(BusyProcesses, OccupancyCountsProcessesBeyondTheTop) {
+  ProcessTable table;
+  Sample(table);
+  std::vector<std::uint32_t> top;
+  table.TopK(1, top);
+  ASSERT_EQ(top.size(), 1u);
+
+  std::vector<std::uint8_t> cpus;
+  table.Occupancy(cpus);
+  EXPECT_EQ(Total(cpus), 2);
+}
+
+// Processes the filter hides are left out of the heatmap
+TEST_F(BusyProcesses, OccupancySkipsFilteredProcesses) {
+  ProcessTable table;
+  std::string error;
+  ASSERT_TRUE(table.SetFilter("pid==" + std::to_string(pids_[0]), error))
+      << error;
+  Sample(table);
+
+  std::vector<std::uint8_t> cpus;
+  table.Occupancy(cpus);
+  EXPECT_EQ(Total(cpus), 1);
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rule_engine.h"
+#include "snapshot.h"
+#include "snapshot_stream.h"
+
+namespace {
+
+// Return a snapshot of one host with its processes in the given order
+Snapshot HostSnapshot(std::vector<std::pair<int, float>> const& processes) {
+  Snapshot snapshot;
+  snapshot.system.uptime = 100;
+  for (auto const& [pid, cpu] : processes) {
+    ProcessRecord record;
+    record.pid = pid;
+    record.cpu = cpu;
+    record.command = "process " + std::to_string(pid);
+    snapshot.processes.push_back(record);
+  }
+  return snapshot;
+}
+
+// Sample the collector until it merged the given number of processes
+bool SampleAll(SnapshotCollector& collector, Snapshot& snapshot,
+               std::size_t count) {
+  for (int attempt = 0; attempt < 200; ++attempt) {
+    collector.Sample(snapshot, count);
+    if (snapshot.processes.size() == count) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  return false;
+}
+
+}  // namespace
+
+// Hosts ranking by another column, e.g. --sort wait, still merge by CPU
+TEST(SnapshotCollector, MergesHostsNotRankedByCpu) {
+  std::string const address =
+      "unix:/tmp/monitor-test-" + std::to_string(getpid()) + ".sock";
+  SnapshotCollector collector{address};
+  ASSERT_TRUE(collector.Start());
+  SnapshotSender first{address, "first", 10};
+  SnapshotSender second{address, "second", 10};
+  first.Publish(HostSnapshot({{11, 0.05f}, {12, 0.50f}, {13, 0.20f}}));
+  second.Publish(HostSnapshot({{21, 0.10f}, {22, 0.40f}, {23, 0.60f}}));
+
+  Snapshot snapshot;
+  ASSERT_TRUE(SampleAll(collector, snapshot, 6));
+  std::vector<int> pids;
+  for (ProcessRecord const& process : snapshot.processes) {
+    pids.push_back(process.pid);
+  }
+  EXPECT_EQ(pids, (std::vector<int>{23, 12, 22, 13, 21, 11}));
+  EXPECT_EQ(snapshot.processes[0].host, "second");
+  EXPECT_EQ(snapshot.processes[1].host, "first");
+}
+
+// The top k are the k busiest processes of all hosts, not each host's first
+TEST(SnapshotCollector, TopKIgnoresHostOrder) {
+  std::string const address =
+      "unix:/tmp/monitor-test-top-" + std::to_string(getpid()) + ".sock";
+  SnapshotCollector collector{address};
+  ASSERT_TRUE(collector.Start());
+  SnapshotSender first{address, "first", 10};
+  SnapshotSender second{address, "second", 10};
+  first.Publish(HostSnapshot({{11, 0.01f}, {12, 0.90f}}));
+  second.Publish(HostSnapshot({{21, 0.02f}, {22, 0.80f}}));
+
+  Snapshot snapshot;
+  ASSERT_TRUE(SampleAll(collector, snapshot, 4));
+  // Both hosts are known now, merge their next messages into the top 2
+  first.Publish(HostSnapshot({{11, 0.01f}, {12, 0.90f}}));
+  bool sampled{false};
+  for (int attempt = 0; attempt < 200 && !sampled; ++attempt) {
+    sampled = collector.Sample(snapshot, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  ASSERT_TRUE(sampled);
+  ASSERT_EQ(snapshot.processes.size(), 2u);
+  EXPECT_EQ(snapshot.processes[0].pid, 12);
+  EXPECT_EQ(snapshot.processes[1].pid, 22);
+}
+
+// A sender ranking by another column still sends its top k by CPU
+TEST(SnapshotCollector, SendersSendTheirTopByCpu) {
+  std::string const address =
+      "unix:/tmp/monitor-test-send-" + std::to_string(getpid()) + ".sock";
+  SnapshotCollector collector{address};
+  ASSERT_TRUE(collector.Start());
+  SnapshotSender sender{address, "first", 2};
+  // Every visible process, ranked by wait, the busiest ones come last
+  sender.Publish(
+      HostSnapshot({{11, 0.01f}, {12, 0.02f}, {13, 0.70f}, {14, 0.30f}}));
+
+  // Asking for more than were sent shows that only the top 2 arrived
+  Snapshot snapshot;
+  bool sampled{false};
+  for (int attempt = 0; attempt < 200 && !sampled; ++attempt) {
+    sampled = collector.Sample(snapshot, 10) && !snapshot.processes.empty();
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  ASSERT_TRUE(sampled);
+  ASSERT_EQ(snapshot.processes.size(), 2u);
+  EXPECT_EQ(snapshot.processes[0].pid, 13);
+  EXPECT_EQ(snapshot.processes[1].pid, 14);
+}
+
+// Processes of different hosts sharing a PID keep their own rule state
+TEST(SnapshotCollector, RulesTellHostsApart) {
+  std::string const address =
+      "unix:/tmp/monitor-test-rules-" + std::to_string(getpid()) + ".sock";
+  SnapshotCollector collector{address};
+  ASSERT_TRUE(collector.Start());
+  RuleEngine rules{collector};
+  std::string error;
+  ASSERT_TRUE(rules.AddRule("process cpu > 10", error)) << error;
+  SnapshotSender first{address, "first", 10};
+  SnapshotSender second{address, "second", 10};
+  // Both hosts run pid 1, started at different times
+  Snapshot busy = HostSnapshot({{1, 0.50f}});
+  Snapshot late = HostSnapshot({{1, 0.50f}});
+  late.processes[0].uptime = 40;
+
+  std::vector<AlertRecord> alerts;
+  Snapshot snapshot;
+  for (int tick = 0; tick < 5; ++tick) {
+    first.Publish(busy);
+    second.Publish(late);
+    // Wait until both messages are merged, so every tick sees both hosts
+    for (int attempt = 0; attempt < 200; ++attempt) {
+      if (rules.Sample(snapshot, 10)) {
+        alerts.insert(alerts.end(), snapshot.alerts.begin(),
+                      snapshot.alerts.end());
+        if (snapshot.processes.size() == 2) {
+          break;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+  }
+
+  std::vector<std::string> subjects;
+  for (AlertRecord const& alert : alerts) {
+    EXPECT_TRUE(alert.firing) << alert.subject;
+    subjects.push_back(alert.subject);
+  }
+  std::sort(subjects.begin(), subjects.end());
+  EXPECT_EQ(subjects, (std::vector<std::string>{"[first] pid 1 (process)",
+                                                 "[second] pid 1 (process)"}));
+}